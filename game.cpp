@@ -5,16 +5,200 @@
 #include <chrono>
 #include <cstdlib>
 #include <ctime>
+#include <array>
+#include <string>
+#include <algorithm>
+#include <memory>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <cerrno>
 #include <atomic>
 #include <condition_variable>
+#include <tuple>
+#include <new>
+#include <type_traits>
+#include <poll.h>
+#include <unistd.h>
+#include <sys/resource.h>
+#include <sys/ioctl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <csignal>
+#if defined(__AVX2__)
+#include <immintrin.h>
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#endif
 
 // **Constantes e Configurações**
-const int width = 100;
-const int height = 40;
+// Campo e limites vêm da linha de comando, de um arquivo (--config) ou do
+// tamanho do terminal; são fixados antes de a partida começar
+int width = 100;
+int height = 40;
+int maxAliveDinos = 5; // Dinossauros vivos que encerram o jogo
+int maxMissiles = 64;  // Mísseis em voo ao mesmo tempo
+int truckCount = 1;       // Caminhões abastecendo o depósito
+int helicopterCount = 1;  // Helicópteros; além do jogador, controlados pelo piloto automático
+const int MAX_TRUCKS = 8;
+const int MAX_HELICOPTERS = 8;
+const int MIN_WIDTH = 70;  // Menor campo em que depósito, caminhão e
+const int MIN_HEIGHT = 30; // helicóptero ainda cabem
+const int MAX_FIELD_SIDE = 10000;  // Largura e altura máximas: a grade cobre o campo inteiro
+const int MAX_ENTITIES = 1000000;  // Teto dos limites de dinossauros e de mísseis
 const int MAX_DEPOT_MISSILES = 10;
-const auto HELICOPTER_RELOAD_TIME = std::chrono::seconds(1);
+const int MAX_MESSAGE = 128;     // Mensagens das linhas 2 e 3 do HUD
+const int TRUCK_WIDTH = 30;
+const int INPUT_QUEUE_SIZE = 64; // Potência de 2
+const int MAX_THREADS = 64;      // Threads acompanhadas pela instrumentação
+const int MAX_WORKERS = 15;      // Trabalhadores do sistema de tarefas
+const int MAX_CHUNKS = MAX_WORKERS + 1;
+const int MAX_GRAPH_JOBS = MAX_CHUNKS + 8;
+const int WORK_QUEUE_SIZE = 256; // Potência de 2
+const int STATS_WINDOW = 1024;   // Amostras usadas nos percentis
+const int GRID_CELL = 8; // Lado de uma célula da grade espacial
+const int TIMER_SLOTS = 256;    // Ticks por volta da roda de eventos (potência de 2)
+const int MAX_TIMERS = MAX_TRUCKS + MAX_HELICOPTERS; // Um evento pendente por veículo
+
+// **Tempos da Simulação**
+// A simulação avança sempre em passos fixos de TICK; cada subsistema
+// acumula o tempo recebido e se move no seu próprio período.
+using Clock = std::chrono::steady_clock;
+using Duration = std::chrono::milliseconds;
+const Duration TICK(10);
+const Duration DINO_STEP(100);
+const Duration MISSILE_STEP(20);
+const Duration TRUCK_STEP(50);
+const Duration TRUCK_TRIP_INTERVAL = std::chrono::seconds(15);
+const Duration TRUCK_UNLOAD_TIME = std::chrono::seconds(2);
+const Duration HELICOPTER_RELOAD_TIME = std::chrono::seconds(1);
+const int DEFAULT_FPS = 30;       // Quadros por segundo sem --fps
+
+// Atrasos dos eventos agendados, em ticks
+constexpr long ticksFor(Duration duration) { return duration / TICK; }
+const Duration MAX_FRAME_LAG(250); // Atraso máximo recuperado de uma vez
 
 // **Estruturas**
+// Flag lida e escrita por threads diferentes. Copiar só com o mundo
+// parado (reinício de rodada no modo headless).
+struct SharedFlag
+{
+    std::atomic<bool> value;
+
+    SharedFlag(bool initial) : value(initial) {}
+    SharedFlag(const SharedFlag &other) : value(other.value.load()) {}
+    SharedFlag &operator=(const SharedFlag &other)
+    {
+        value.store(other.value.load());
+        return *this;
+    }
+    SharedFlag &operator=(bool flag)
+    {
+        value.store(flag, std::memory_order_release);
+        return *this;
+    }
+    operator bool() const { return value.load(std::memory_order_acquire); }
+};
+
+// **Entidades e Componentes**
+// Cada tipo de entidade é uma tabela com um array contíguo por componente
+// (EntityTable). Um sistema percorre só os arrays dos componentes que lê,
+// e um tipo novo de entidade é uma tabela a mais no World, sem thread nem
+// global. Remover troca com a última linha, então as tabelas ficam compactas.
+struct Position
+{
+    int x, y;
+};
+
+// Só horizontal: células por passo, negativo para a esquerda. A direção
+// também escolhe o desenho.
+struct Velocity
+{
+    int dx;
+};
+
+// Desenho do atlas usado pela entidade (Sprite é o desenho em si)
+enum class SpriteId : uint8_t
+{
+    Dino,
+    Missile,
+    Helicopter,
+    Truck
+};
+
+struct Health
+{
+    int headshotHits; // Tiros na cabeça recebidos
+};
+
+struct Ammo
+{
+    int missiles;
+    int capacity;
+};
+
+enum class HelicopterState
+{
+    Normal,
+    Reloading
+};
+
+// Estado do helicóptero no depósito
+struct Pilot
+{
+    HelicopterState state;
+    int reloadTimer; // Evento que termina o recarregamento, -1 sem evento
+};
+
+enum class TruckState
+{
+    Waiting,     // Intervalo entre viagens
+    Entering,    // Indo até o depósito
+    AtDepot,     // Esperando espaço no depósito
+    Unloading,   // Descarregando
+    Leaving      // Saindo pela direita
+};
+
+struct Delivery
+{
+    TruckState state;
+};
+
+template <typename... Components>
+struct EntityTable
+{
+    std::tuple<std::vector<Components>...> columns;
+
+    template <typename C>
+    std::vector<C> &column() { return std::get<std::vector<C>>(columns); }
+    template <typename C>
+    const std::vector<C> &column() const { return std::get<std::vector<C>>(columns); }
+
+    int size() const { return (int)std::get<0>(columns).size(); }
+    void add(const Components &...components) { (column<Components>().push_back(components), ...); }
+    void remove(int i)
+    {
+        int last = size() - 1;
+        ((column<Components>()[i] = column<Components>()[last], column<Components>().pop_back()), ...);
+    }
+    void clear() { (column<Components>().clear(), ...); } // Mantém a capacidade
+    void reserve(int count) { (column<Components>().reserve(count), ...); }
+
+    // Chama f com cada coluna, na ordem dos componentes
+    template <typename F>
+    void forEachColumn(F &&f) { (f(column<Components>()), ...); }
+    template <typename F>
+    void forEachColumn(F &&f) const { (f(column<Components>()), ...); }
+};
+
+// Só os vivos: um dinossauro morto sai da tabela
+using DinoTable = EntityTable<Position, Velocity, SpriteId, Health>;
+using MissileTable = EntityTable<Position, Velocity, SpriteId>;   // Em voo
+using HelicopterTable = EntityTable<Position, Velocity, SpriteId, Ammo, Pilot>; // O primeiro é o do jogador
+using TruckTable = EntityTable<Position, Velocity, SpriteId, Delivery>;
+
+// Cópias de uma linha das tabelas, usadas pelos testes de colisão
 struct Dino
 {
     int x, y;         // Posição
@@ -30,45 +214,710 @@ struct Missile
     bool movingRight; // Direção do movimento
 };
 
-// **Variáveis Globais**
-std::mutex mtx;        // Mutex para sincronização geral
-std::mutex depotMutex; // Mutex para o depósito
-std::condition_variable depotNotFull;
-std::condition_variable depotNotEmpty;
+struct Helicopter
+{
+    int x, y;
+    bool movingRight;
+    HelicopterState state;
+    int missiles;
+    int maxMissiles;
+};
 
-bool running = true;   // Controle do loop principal
-bool gameOver = false; // Estado do jogo
-bool truckUnloading = false;
-bool helicopterReloading = false;
+Dino dinoAt(const DinoTable &dinos, int i);
+Missile missileAt(const MissileTable &missiles, int i);
+Helicopter helicopterAt(const HelicopterTable &helicopters, int i);
 
-std::atomic<int> depotMissiles{MAX_DEPOT_MISSILES};
-int MAX_HELICOPTER_MISSILES = 10; // Ajustado com base na dificuldade
-std::atomic<int> helicopterMissiles;
-int m = 1;  // Número de tiros na cabeça para matar o dinossauro
-int n = 10; // Capacidade de mísseis do helicóptero
-int t = 5;  // Tempo para gerar um novo dinossauro
+// Fila circular sem travas para um produtor e um consumidor. A thread de
+// entrada escreve em tail e a simulação lê em head; cada índice só é
+// escrito por um lado, então basta acquire/release.
+template <typename T, int Capacity>
+struct SpscRing
+{
+    static_assert((Capacity & (Capacity - 1)) == 0, "Capacity deve ser potência de 2");
 
-// **Objetos do Jogo**
-std::vector<std::thread> missileThreads; // Threads dos mísseis
-std::vector<Dino> dinos;                 // Lista de dinossauros
+    std::array<T, Capacity> items;
+    alignas(64) std::atomic<unsigned> head{0}; // Próximo a ler
+    alignas(64) std::atomic<unsigned> tail{0}; // Próximo a escrever
 
-// **Variáveis do Helicóptero**
-int helicopterX = 40, helicopterY = 20;
-bool helicopterMovingRight = true;
+    bool push(const T &item)
+    {
+        unsigned t = tail.load(std::memory_order_relaxed);
+        if (t - head.load(std::memory_order_acquire) == Capacity)
+            return false; // Cheia
+        items[t & (Capacity - 1)] = item;
+        tail.store(t + 1, std::memory_order_release);
+        return true;
+    }
 
-enum class HelicopterState
+    bool pop(T &item)
+    {
+        unsigned h = head.load(std::memory_order_relaxed);
+        if (h == tail.load(std::memory_order_acquire))
+            return false; // Vazia
+        item = items[h & (Capacity - 1)];
+        head.store(h + 1, std::memory_order_release);
+        return true;
+    }
+};
+
+using InputQueue = SpscRing<int, INPUT_QUEUE_SIZE>;
+
+// Fila limitada lock-free com vários produtores e vários consumidores
+// (Vyukov). O número de sequência de cada célula diz de quem é a vez:
+// igual à posição, livre para quem escreve; posição + 1, pronta para quem
+// lê. Quem perde a corrida pela posição só tenta a próxima.
+template <typename T, int Capacity>
+struct MpmcQueue
 {
-    Normal,
-    Reloading
+    struct alignas(64) Slot
+    {
+        std::atomic<size_t> sequence;
+        T item;
+    };
+
+    std::array<Slot, Capacity> slots;
+    alignas(64) std::atomic<size_t> tail{0}; // Próxima posição a escrever
+    alignas(64) std::atomic<size_t> head{0}; // Próxima posição a ler
+
+    MpmcQueue()
+    {
+        for (int i = 0; i < Capacity; i++)
+            slots[i].sequence.store(i, std::memory_order_relaxed);
+    }
+
+    // Copiar só com a fila parada (reinício de rodada, cópia do quadro)
+    MpmcQueue(const MpmcQueue &other) { *this = other; }
+    MpmcQueue &operator=(const MpmcQueue &other)
+    {
+        for (int i = 0; i < Capacity; i++)
+        {
+            slots[i].sequence.store(other.slots[i].sequence.load(std::memory_order_relaxed), std::memory_order_relaxed);
+            slots[i].item = other.slots[i].item;
+        }
+        tail.store(other.tail.load(std::memory_order_relaxed), std::memory_order_relaxed);
+        head.store(other.head.load(std::memory_order_relaxed), std::memory_order_relaxed);
+        return *this;
+    }
+
+    bool push(const T &item)
+    {
+        size_t position = tail.load(std::memory_order_relaxed);
+        for (;;)
+        {
+            Slot &slot = slots[position % Capacity];
+            size_t sequence = slot.sequence.load(std::memory_order_acquire);
+            long distance = (long)(sequence - position);
+            if (distance < 0)
+                return false; // Cheia: a célula ainda não foi lida na volta anterior
+            if (distance > 0)
+                position = tail.load(std::memory_order_relaxed); // Outro produtor avançou
+            else if (tail.compare_exchange_weak(position, position + 1, std::memory_order_relaxed))
+            {
+                slot.item = item;
+                slot.sequence.store(position + 1, std::memory_order_release);
+                return true;
+            }
+        }
+    }
+
+    bool pop(T &item)
+    {
+        size_t position = head.load(std::memory_order_relaxed);
+        for (;;)
+        {
+            Slot &slot = slots[position % Capacity];
+            size_t sequence = slot.sequence.load(std::memory_order_acquire);
+            long distance = (long)(sequence - (position + 1));
+            if (distance < 0)
+                return false; // Vazia: a célula ainda não foi escrita
+            if (distance > 0)
+                position = head.load(std::memory_order_relaxed); // Outro consumidor avançou
+            else if (head.compare_exchange_weak(position, position + 1, std::memory_order_relaxed))
+            {
+                item = slot.item;
+                slot.sequence.store(position + Capacity, std::memory_order_release);
+                return true;
+            }
+        }
+    }
+
+    // Exato com a fila parada; aproximado durante operações concorrentes
+    int size() const
+    {
+        size_t written = tail.load(std::memory_order_acquire);
+        size_t read = head.load(std::memory_order_acquire);
+        return written > read ? (int)(written - read) : 0;
+    }
+};
+
+// **Gravação e Replay**
+// Arquivo de texto com a semente, a configuração e cada tecla com o tick
+// em que foi aplicada:
+//   DINOREC 4
+//   seed <semente>
+//   difficulty <m> <n> <t>
+//   missile-speed <células por passo>
+//   field <largura> <altura>
+//   limits <dinossauros> <mísseis>
+//   fleet <caminhões> <helicópteros>
+//   key <tick> <tecla>
+//   end <ticks>
+struct KeyEvent
+{
+    long tick;
+    int key;
+};
+
+struct Recording
+{
+    uint64_t seed = 0;
+    int m = 1, n = 10, t = 5;
+    int missileSpeed = 1;
+    int width = 100, height = 40;
+    int maxDinos = 5, maxMissiles = 64;
+    int trucks = 1, helicopters = 1;
+    std::vector<KeyEvent> events;
+    long endTick = -1;
+};
+
+// Grava as teclas da partida; usado só pela thread da simulação
+struct Recorder
+{
+    FILE *file = nullptr;
+
+    bool open(const char *path, uint64_t seed, int m, int n, int t, int missileSpeed);
+    void key(long tick, int key);
+    void close(long tick);
+};
+
+// **Jogo Salvo**
+// Arquivo binário com o mundo inteiro, para salvar, continuar e começar
+// benchmarks com o campo já cheio. Depois do cabeçalho vêm o depósito
+// (com os mísseis na ordem da fila), a roda de eventos byte a byte, as
+// duas mensagens e as tabelas de entidades, cada uma com o número de
+// linhas seguido de cada coluna inteira. Sem conversão de ordem de bytes:
+// o arquivo é lido na máquina que o escreveu. A leitura mapeia o arquivo
+// (mmap) e copia cada coluna direto do mapa para a tabela já reservada.
+const char SAVE_MAGIC[8] = "DINOSAV";
+const uint32_t SAVE_VERSION = 1;
+
+struct SaveHeader
+{
+    char magic[8];
+    uint32_t version;
+    int32_t width, height;
+    int32_t maxDinos, maxMissiles;
+    int32_t trucks, helicopters;
+    int32_t m, n, t;
+    int32_t missileSpeed;
+    uint8_t gameOver, endless, unused[2];
+    int64_t tick;
+    uint64_t rngState;
+    int64_t spawnMillis, dinoMillis, missileMillis; // Acumuladores dos subsistemas
+};
+
+struct SaveDepot
+{
+    int32_t x, y;
+    int32_t trucksUnloading, helicoptersReloading;
+    int64_t delivered, consumed;
+    int32_t crates, unused;
+};
+
+// Leitura em sequência do arquivo mapeado; passar do fim invalida tudo
+struct SaveReader
+{
+    const char *data;
+    size_t size;
+    size_t offset = 0;
+    bool ok = true;
+
+    bool read(void *out, size_t bytes);
+};
+
+// Opções da linha de comando
+struct Options
+{
+    bool headless = false;
+    long ticks = 1000000;
+    int difficulty = 3;
+    int workers = -1;
+    bool seedGiven = false;
+    uint64_t seed = 0;
+    int missileSpeed = 1;
+    int fps = DEFAULT_FPS;
+    int fieldWidth = 0, fieldHeight = 0; // 0: tamanho do terminal (100x40 sem terminal)
+    int maxDinos = 0, maxMissiles = 0;   // 0: padrão do modo escolhido
+    bool stress = false;                 // Campo cheio de dinossauros e mísseis
+    int trucks = 1, helicopters = 1;
+    bool depotBench = false;             // Vazão da fila do depósito com threads reais
+    bool checkAllocs = false;            // Headless falha se o laço do jogo alocar
+    bool moveBench = false;              // Custo do passo de movimento em lote
+    const char *benchPath = nullptr;     // Suíte de benchmarks, resultado em JSON
+    const char *benchFilter = nullptr;   // Só os benchmarks com este trecho no nome
+    double benchMinTime = 0.2;           // Segundos medidos por benchmark
+    const char *statsPath = nullptr;
+    const char *recordPath = nullptr;
+    const char *replayPath = nullptr;
+    const char *savePath = nullptr; // Salva o mundo ao sair
+    const char *loadPath = nullptr; // Começa do mundo salvo
+};
+
+// Grade uniforme sobre o campo: cada célula lista os dinossauros que a
+// cobrem, em ordem de índice. Reconstruída a cada tick por contagem,
+// sem alocar depois que o vetor de entradas atinge o tamanho máximo.
+struct SpatialGrid
+{
+    int columns = 0, rows = 0;
+    std::vector<int> cellStart;
+    std::vector<int> cursor;
+    std::vector<int> entries; // Índices em dinos, agrupados por célula
+
+    // Memória para o pior caso: cada dinossauro cobrindo o máximo de células
+    void reserve(int maxDinos);
+    void build(const DinoTable &dinos);
+    // Acompanha dinos.remove(index) sem reconstruir: as entradas de index
+    // viram -1 e as da última linha, que foi para index, são renomeadas e
+    // mantidas em ordem crescente na célula, como build() as deixaria
+    void removeSwapped(int index, const Position &removed, int last, const Position &moved);
+    // Retorna a célula de (x, y), ou -1 fora do campo
+    int cellAt(int x, int y) const;
+    // Células cobertas pela caixa de um dinossauro em position
+    void cellRange(const Position &position, int &x0, int &x1, int &y0, int &y1) const;
+};
+
+// Os caminhões produzem e os helicópteros consomem mísseis pela mesma
+// fila limitada; cada item guarda o caminhão que o entregou (-1: estoque
+// inicial)
+struct Depot
+{
+    int x = width - 20, y = height - 15;
+    MpmcQueue<int, MAX_DEPOT_MISSILES> missiles;
+    int trucksUnloading = 0;
+    int helicoptersReloading = 0;
+    long delivered = 0; // Mísseis entregues pelos caminhões
+    long consumed = 0;  // Mísseis levados pelos helicópteros
+};
+
+enum class TimerEvent
+{
+    TruckDeparts,  // Fim do intervalo entre viagens
+    TruckMoves,    // Uma coluna a mais na entrada ou na saída
+    TruckUnloaded, // Fim da descarga
+    ReloadDone     // Fim do recarregamento do helicóptero
+};
+
+// Roda de eventos com nós fixos: o balde de um tick guarda os eventos que
+// vencem nele módulo TIMER_SLOTS; os de voltas futuras ficam no balde até
+// a volta certa. Agendar e cancelar são O(1) e nada aloca durante o jogo.
+struct TimerWheel
+{
+    struct Timer
+    {
+        long due;
+        TimerEvent event;
+        int subject; // Caminhão ou helicóptero do evento
+        int next;    // Próximo nó do balde ou da lista livre
+    };
+
+    std::array<Timer, MAX_TIMERS> timers;
+    std::array<int, TIMER_SLOTS> slots; // Primeiro nó de cada balde, -1 se vazio
+    int freeList = 0;
+
+    TimerWheel();
+    // Retorna o nó do evento, usado para cancelá-lo antes de vencer
+    int schedule(long due, TimerEvent event, int subject);
+    void cancel(int timer);
+    // Tira do balde do tick os eventos vencidos e os entrega em ordem de agendamento
+    template <typename Handler>
+    void expire(long tick, Handler &&handler);
+    // Confere os encadeamentos de uma roda lida do disco: índices válidos,
+    // cada nó em exatamente uma lista, no balde certo e sem vencer no passado
+    bool valid(long tick) const;
+    // O nó está agendado (em algum balde), não na lista livre
+    bool scheduled(int timer) const;
+};
+
+// **Instrumentação**
+// Durações em microssegundos. Os percentis usam só as últimas
+// STATS_WINDOW amostras, então refletem o comportamento recente.
+// Alocações no heap desde o início do programa, contadas pelo operator
+// new global. O modo headless mede o laço do jogo com ele.
+std::atomic<long> heapAllocations{0};
+
+struct LatencySummary
+{
+    long count = 0;
+    float p50 = 0, p99 = 0, max = 0, mean = 0;
+};
+
+struct LatencyStats
+{
+    std::array<float, STATS_WINDOW> samples;
+    long count = 0;
+    double total = 0;
+    float max = 0;
+
+    void add(float micros);
+    LatencySummary summary() const;
+};
+
+// Nome de cada thread registrada; o índice é usado pelos contadores por thread
+struct ThreadRegistry
+{
+    std::array<const char *, MAX_THREADS> names{};
+    std::atomic<int> registered{0};
+    std::atomic<int> alive{0};
+};
+
+// Registra a thread atual enquanto o objeto existir
+struct ThreadScope
+{
+    explicit ThreadScope(const char *name);
+    ~ThreadScope();
+};
+
+ThreadRegistry threads;
+thread_local int threadSlot = 0;
+
+float elapsedMicros(Clock::time_point start);
+
+// Cópia do estado visível, lida pelo desenho sem tocar no mundo
+struct WorldSnapshot
+{
+    DinoTable dinos;
+    MissileTable missiles;
+    HelicopterTable helicopters;
+    TruckTable trucks;
+    Depot depot;
+    std::string message;      // Linha 2
+    std::string truckMessage; // Linha 3
+    bool gameOver = false;
+    bool showStats = false;
+    LatencySummary tickTimes, dinoTimes, missileTimes;
+
+    // Capacidade para a maior rodada, para a cópia do mundo não alocar
+    void reserve();
+};
+
+// **Sincronização**
+// A simulação é a única thread que escreve no mundo. As outras só veem
+// cópias publicadas; a única trava compartilhada é a da troca de quadros,
+// e ela mede, por thread, quanto tempo se esperou e se segurou a trava.
+struct LockCounters
+{
+    std::atomic<unsigned long> acquisitions{0};
+    std::atomic<unsigned long> contended{0}; // Aquisições que tiveram de esperar
+    std::atomic<unsigned long> waitNanos{0};
+    std::atomic<unsigned long> holdNanos{0};
+};
+
+struct ProfiledMutex
+{
+    std::mutex mutex;
+    std::array<LockCounters, MAX_THREADS> perThread;
+    Clock::time_point lockedAt; // Só o dono da trava escreve
+
+    void lock();
+    void unlock();
+    LockCounters &counters() { return perThread[threadSlot]; }
+    unsigned long total(std::atomic<unsigned long> LockCounters::*field) const;
+};
+
+// Último quadro publicado pela simulação. Publicar e retirar só trocam os
+// buffers (swap), então a trava fica presa por poucas instruções.
+struct SnapshotExchange
+{
+    ProfiledMutex mutex;
+    WorldSnapshot latest;
+    int pending = 0; // Publicações desde a última retirada
+
+    void publish(WorldSnapshot &snap);
+    // Retorna quantos ticks o quadro retirado junta (0: nada novo)
+    int take(WorldSnapshot &snap);
+};
+
+// Pedido de parada de uma sessão. Toda espera das threads da sessão passa
+// por aqui, então cancel() acorda simulação, desenho e entrada na hora em
+// vez de deixar cada uma terminar seu sleep ou timeout.
+struct CancellationToken
+{
+    CancellationToken();
+    ~CancellationToken();
+
+    void cancel();
+    // Rearma o token; só quando ninguém mais espera nele
+    void reset();
+    bool cancelled() const { return stopped.load(std::memory_order_acquire); }
+    // Dorme até o prazo; retorna false se a sessão foi cancelada antes
+    bool sleepUntil(Clock::time_point deadline);
+    // Fica legível no cancelamento, para quem espera em poll()
+    int fd() const { return wakePipe[0]; }
+
+    Clock::time_point cancelledAt; // Início do encerramento
+
+private:
+    std::atomic<bool> stopped{false};
+    std::mutex mutex;
+    std::condition_variable wake;
+    int wakePipe[2];
+};
+
+// **Sistema de Tarefas**
+// Trabalhadores fixos, cada um com sua fila. O dono empilha e desempilha
+// no fim da própria fila; quem fica sem trabalho rouba do começo da fila
+// de outro. As tarefas de um tick formam um grafo com dependências.
+struct JobGraph;
+
+struct Job
+{
+    void (*run)(void *context) = nullptr;
+    void *context = nullptr;
+    JobGraph *graph = nullptr;
+    int dependencyCount = 0;
+    std::atomic<int> unfinishedDependencies{0};
+    std::array<Job *, MAX_CHUNKS> successors{};
+    int successorCount = 0;
+};
+
+struct JobGraph
+{
+    std::array<Job, MAX_GRAPH_JOBS> jobs;
+    int count = 0;
+    std::atomic<int> remaining{0};
+
+    Job &add(void (*run)(void *context), void *context);
+    void depend(Job &before, Job &after); // after só roda depois de before
+};
+
+struct WorkQueue
+{
+    std::mutex mutex;
+    std::array<Job *, WORK_QUEUE_SIZE> jobs;
+    unsigned head = 0, tail = 0;
+
+    bool push(Job *job);
+    Job *pop();   // Fim da fila (dono)
+    Job *steal(); // Começo da fila (ladrões)
+};
+
+struct JobSystem
+{
+    explicit JobSystem(int workerCount);
+    ~JobSystem();
+
+    int workerCount() const { return total; }
+    // Roda o grafo inteiro; a thread que chama também executa tarefas
+    void run(JobGraph &graph);
+
+private:
+    void workerLoop(int index);
+    void submit(Job *job);
+    void execute(Job *job);
+    Job *findJob(int index);
+
+    std::vector<std::thread> workers;
+    int total = 0; // Fixo antes de os trabalhadores nascerem; workers cresce enquanto isso
+    std::array<WorkQueue, MAX_WORKERS + 1> queues; // A última é de quem chama run()
+    std::atomic<bool> stopping{false};
+    std::atomic<int> queued{0};
+    std::atomic<int> sleepers{0};
+    std::mutex sleepMutex;
+    std::condition_variable wakeUp;
+};
+
+thread_local int workerIndex = -1;
+
+// **Buffer de Quadro**
+const int HUD_LINES = 4; // Linhas de texto sobre o topo do campo
+
+// Pares de cor
+const short PAIR_SKY = 1;
+const short PAIR_GRASS = 2;
+const short PAIR_SKY_INK = 3;   // Desenho sobre o céu
+const short PAIR_GRASS_INK = 4; // Desenho sobre a grama
+
+struct Cell
+{
+    char ch;
+    short pair;
+
+    bool operator==(const Cell &other) const { return ch == other.ch && pair == other.pair; }
+    bool operator!=(const Cell &other) const { return !(*this == other); }
+};
+
+// Quadro montado fora da tela, do tamanho da parte visível do campo; o
+// texto do HUD fica à parte porque tem acentos (UTF-8) e não cabe em uma
+// célula por byte
+struct FrameBuffer
+{
+    int columns = 0, rows = 0;    // Tamanho da área visível
+    int originX = 0, originY = 0; // Ponto do campo mostrado em (0, 0)
+    std::vector<Cell> cells;
+    std::array<std::string, HUD_LINES> hud;
+
+    void resize(int newColumns, int newRows);
+    Cell &at(int x, int y) { return cells[y * columns + x]; }
+    const Cell &at(int x, int y) const { return cells[y * columns + x]; }
+    // Coordenadas da tela, não do campo
+    void putString(int x, int y, const char *text);
+};
+
+// Ritmo dos quadros, como um vsync: os prazos ficam numa grade fixa de
+// período 1/fps. Terminal lento perde prazos (contados e pulados) em vez
+// de desenhar em rajada; ticks que chegam entre dois prazos viram um
+// quadro só, então o custo do desenho não cresce com a simulação.
+struct FramePacer
+{
+    Clock::duration period = std::chrono::nanoseconds(1000000000 / DEFAULT_FPS);
+    int targetFps = DEFAULT_FPS;
+    long presented = 0; // Quadros enviados ao terminal
+    long idle = 0;      // Prazos sem nada novo para desenhar
+    long dropped = 0;   // Prazos perdidos por atraso do desenho
+    long coalesced = 0; // Ticks juntados a outro no mesmo quadro
+    float fps = 0;      // Medido na última janela de um segundo
+
+    void setTarget(int framesPerSecond);
+    void start();
+    // Próximo prazo na grade, pulando os que já passaram
+    Clock::time_point advance();
+    void framePresented(Clock::time_point when);
+    void stop();
+    // Média de todas as rodadas
+    float averageFps() const;
+
+private:
+    Clock::time_point next;
+    Clock::time_point roundStart;
+    Clock::time_point windowStart;
+    long windowFrames = 0;
+    Clock::duration active{0};
+};
+
+// Compara o quadro novo com o que já está no terminal e só emite as
+// células que mudaram, com um único doupdate() por quadro
+struct Renderer
+{
+    FrameBuffer back;  // Quadro sendo montado
+    FrameBuffer front; // Quadro exibido no terminal
+    bool fullRedraw = true;
+
+    LatencyStats frameTimes;                  // Montagem + envio de cada quadro
+    FramePacer pacer;
+    const ProfiledMutex *watchedLock = nullptr; // Trava mostrada no painel
+    std::vector<char> run;                      // Trecho de células de uma escrita
+
+    // Terminal menor que o campo: mostra a parte em volta do helicóptero
+    void resize(int terminalColumns, int terminalRows);
+    void compose(const WorldSnapshot &snap);
+    void present();
+    void drawStats(const WorldSnapshot &snap);
+};
+
+// **Mundo**
+
+// Gerador pseudoaleatório do mundo (SplitMix64). Fica dentro do World para
+// que a mesma semente e as mesmas teclas reproduzam a mesma partida.
+struct Random
+{
+    uint64_t state;
+
+    uint64_t next();
+    int below(int limit) { return (int)(next() % (uint64_t)limit); }
+};
+
+struct World
+{
+    int m; // Número de tiros na cabeça para matar o dinossauro
+    int n; // Capacidade de mísseis do helicóptero
+    int t; // Tempo para gerar um novo dinossauro
+    int missileSpeed = 1; // Células que um míssil anda por passo
+
+    SharedFlag running{true};   // Controle do loop principal
+    SharedFlag gameOver{false}; // Estado do jogo
+    long tick = 0;         // Ticks já simulados
+    Random rng;
+
+    DinoTable dinos;
+    MissileTable missiles;
+    SpatialGrid grid;        // Dinossauros por região, para as colisões
+    HelicopterTable helicopters;
+    TruckTable trucks;
+    Depot depot;
+    std::string message;
+    std::string truckMessage;
+    TimerWheel timers; // Caminhão, descarga e recarregamento
+
+    Duration spawnTimer{0};
+    Duration dinoTimer{0};
+    Duration missileTimer{0};
+
+    bool endless = false;    // Estresse: nenhuma condição encerra a rodada
+    bool showStats = false;  // Painel de desempenho (tecla 'p')
+    bool profiling = false;  // Mede cada passo dos subsistemas
+    LatencyStats tickTimes;
+    LatencyStats dinoTimes;
+    LatencyStats missileTimes;
+
+    // Passos pendentes do tick atual, calculados antes de rodar os estágios
+    int pendingSpawns = 0;
+    int pendingDinoSteps = 0;
+    int pendingMissileSteps = 0;
+    Clock::time_point dinoStart;
+    std::array<bool, MAX_CHUNKS> chunkHitHelicopter{};
+    struct TickScheduler *scheduler = nullptr; // Nulo: estágios em sequência
+
+    World(int m, int n, int t, uint64_t seed);
+    // Nova rodada no mesmo objeto: reaproveita a memória de dinossauros,
+    // mísseis, grade e frota; mantém configuração e medições
+    void reset(int m, int n, int t, uint64_t seed);
+
+    void handleKey(int ch);
+    void step(Duration dt);
+    void snapshot(WorldSnapshot &snap) const;
+
+    // Estágios de um tick; o agendador pode rodá-los em paralelo
+    void spawnStage();
+    void moveDinoChunk(int chunk, int chunks);
+    void finishDinoStage(int chunks);
+    void missileStage();
+    void timerStage();
+
+private:
+    void spawnDino();
+    void advanceMissiles();
+    void controlHelicopter(int index, int ch);
+    void notify(int index, const char *text);
+    void after(Duration delay, TimerEvent event, int subject);
+    void handleTimer(TimerEvent event, int subject);
+    void moveTruck(int index);
+    void tryUnloadTruck(int index);
+    void tryStartReload(int index);
+    void helicopterMoved(int index);
+};
+
+// Grafo fixo de um tick:
+//   geração -> dinos (em blocos paralelos) -> fechamento -> mísseis
+//   eventos do depósito (caminhão e recarregamento)
+struct DinoChunk
+{
+    World *world;
+    int index;
+    int count;
 };
-HelicopterState helicopterState = HelicopterState::Normal;
-std::chrono::time_point<std::chrono::steady_clock> reloadStartTime;
 
-// **Posição do Depósito**
-int depositX = 0, depositY = 10;
+struct TickScheduler
+{
+    TickScheduler(JobSystem &jobs, World &world);
+    void run() { jobs.run(graph); }
+
+    JobSystem &jobs;
+    JobGraph graph;
+    std::array<DinoChunk, MAX_CHUNKS> chunks;
+};
 
 // **Representações Gráficas**
-const char *dinoForm[6] = {
+const char *const dinoForm[] = {
     "              __",
     "             / _)",
     "    _/\\/\\/\\_/ /",
@@ -76,7 +925,7 @@ const char *dinoForm[6] = {
     "  _|  (  | (  |",
     " /__.-|_|--|_|"};
 
-const char *dinoReversed[6] = {
+const char *const dinoReversed[] = {
     " __              ",
     "(_ \\             ",
     " \\_ \\_/\\/\\/\\/    ",
@@ -84,648 +933,3386 @@ const char *dinoReversed[6] = {
     "  | )  | )  |_   ",
     " |_|--|_|-.__\\ "};
 
-const char *truckRight[5] = {
+const char *const truckRight[] = {
     "     __             ",
     "   _|__| ___      ",
     " _||_|_||___\\___  ",
     "|   _   |~ _  '-.",
     "'--(_)----(_)--'"};
 
-const char *truckLeft[5] = {
-    "      ___ ",
-    "  ___/___|______",
-    ".-' _  ~ | _    |",
-    " -(_)----(_)---'"};
+const char *const truckLeft[] = {
+    "      ___ ",
+    "  ___/___|______",
+    ".-' _  ~ | _    |",
+    " -(_)----(_)---'"};
+
+const char *const helicopterRight[] = {
+    "   __|__ ",
+    "--@--@--o"};
+
+const char *const helicopterLeft[] = {
+    " __|__   ",
+    "o--@--@--"};
+
+const char *const depositForm[] = {
+    "      _______",
+    "     /       \\",
+    "    /_________\\",
+    "    |         |",
+    "    |         |",
+    "    |_________|"};
+
+const char *const missileForm[] = {"-"};
+
+// **Atlas de Sprites**
+// Tudo calculado em tempo de compilação a partir dos desenhos acima:
+// tamanho, máscara de células opacas (bit c da linha r = coluna c não é
+// espaço) e a caixa que envolve as células opacas. Desenho e colisão
+// usam os mesmos dados, sem nenhuma alocação.
+const int MAX_SPRITE_ROWS = 6;
+
+struct Box
+{
+    int x, y, width, height;
+};
+
+struct Sprite
+{
+    std::array<const char *, MAX_SPRITE_ROWS> rows;
+    int width, height;
+    std::array<uint64_t, MAX_SPRITE_ROWS> mask;
+    Box bounds;
+};
+
+template <size_t Rows>
+constexpr Sprite makeSprite(const char *const (&rows)[Rows])
+{
+    static_assert(Rows <= MAX_SPRITE_ROWS, "Sprite com linhas demais");
+    Sprite sprite{};
+    sprite.height = Rows;
+    int minX = 64, maxX = -1, minY = Rows, maxY = -1;
+    for (int r = 0; r < (int)Rows; r++)
+    {
+        sprite.rows[r] = rows[r];
+        int c = 0;
+        for (; rows[r][c]; c++)
+        {
+            if (rows[r][c] == ' ')
+                continue;
+            sprite.mask[r] |= uint64_t(1) << c;
+            minX = std::min(minX, c);
+            maxX = std::max(maxX, c);
+            minY = std::min(minY, r);
+            maxY = std::max(maxY, r);
+        }
+        sprite.width = std::max(sprite.width, c);
+    }
+    sprite.bounds = {minX, minY, maxX - minX + 1, maxY - minY + 1};
+    return sprite;
+}
+
+constexpr Sprite SPRITE_DINO_RIGHT = makeSprite(dinoForm);
+constexpr Sprite SPRITE_DINO_LEFT = makeSprite(dinoReversed);
+constexpr Sprite SPRITE_TRUCK_RIGHT = makeSprite(truckRight);
+constexpr Sprite SPRITE_TRUCK_LEFT = makeSprite(truckLeft);
+constexpr Sprite SPRITE_HELICOPTER_RIGHT = makeSprite(helicopterRight);
+constexpr Sprite SPRITE_HELICOPTER_LEFT = makeSprite(helicopterLeft);
+constexpr Sprite SPRITE_DEPOSIT = makeSprite(depositForm);
+constexpr Sprite SPRITE_MISSILE = makeSprite(missileForm);
+
+constexpr int HELICOPTER_WIDTH = SPRITE_HELICOPTER_RIGHT.width;
+constexpr int HELICOPTER_HEIGHT = SPRITE_HELICOPTER_RIGHT.height;
+static_assert(SPRITE_HELICOPTER_LEFT.width == HELICOPTER_WIDTH, "Helicóptero muda de largura ao virar");
+
+// Caixa que cobre o dinossauro nas duas direções
+constexpr int DINO_WIDTH = std::max(SPRITE_DINO_RIGHT.width, SPRITE_DINO_LEFT.width);
+constexpr int DINO_HEIGHT = std::max(SPRITE_DINO_RIGHT.height, SPRITE_DINO_LEFT.height);
+// Só as células opacas nas duas direções; é o que a grade espacial cobre
+constexpr Box unionBox(const Box &a, const Box &b)
+{
+    int x = std::min(a.x, b.x), y = std::min(a.y, b.y);
+    return {x, y, std::max(a.x + a.width, b.x + b.width) - x, std::max(a.y + a.height, b.y + b.height) - y};
+}
+constexpr Box DINO_BOUNDS = unionBox(SPRITE_DINO_RIGHT.bounds, SPRITE_DINO_LEFT.bounds);
+constexpr int DINO_HEAD_ROWS = 2; // Linhas do desenho que contam como cabeça
+static_assert(SPRITE_DINO_RIGHT.width <= 64 && SPRITE_TRUCK_RIGHT.width <= 64, "Máscara de 64 colunas");
+
+// **Protótipos das Funções**
+void drawSprite(FrameBuffer &frame, const Sprite &sprite, int x, int y);
+void drawSkyAndGrass(FrameBuffer &frame);
+const Sprite &spriteFor(SpriteId id, bool movingRight);
+template <typename Table>
+void drawEntities(FrameBuffer &frame, const Table &table);
+void drawDeposit(FrameBuffer &frame, int x, int y);
+int consumeSteps(Duration &accumulator, Duration dt, Duration period);
+void moveEntitiesScalar(Position *position, const Velocity *velocity, int begin, int end);
+void moveEntities(Position *position, const Velocity *velocity, int begin, int end);
+void moveAndBounceScalar(Position *position, Velocity *velocity, int begin, int end, int maxX);
+void moveAndBounce(Position *position, Velocity *velocity, int begin, int end, int maxX);
+const char *movementKernel();
+bool isHelicopterAtDepot(const Helicopter &helicopter, const Depot &depot);
+const Sprite &dinoSprite(const Dino &dino);
+bool spriteCellOpaque(const Sprite &sprite, int spriteX, int spriteY, int x, int y, int firstRow, int lastRow);
+bool spritesOverlap(const Sprite &a, int ax, int ay, const Sprite &b, int bx, int by);
+int sweepMissileAgainstDino(const Missile &missile, int fromX, const Dino &dino);
+bool checkCollisionWithDinoHead(const Missile &missile, Dino &dino, int headshotsToKill);
+bool checkCollisionWithDinoBody(const Missile &missile, const Dino &dino);
+bool checkCollisionWithHelicopter(const Helicopter &helicopter, const Dino &dino);
+int countAliveDinos(const DinoTable &dinos);
+void applyDifficulty(int choice, int &m, int &n, int &t);
+bool showDifficultyMenu(struct SessionManager &session, int &m, int &n, int &t);
+void inputLoop(WINDOW *window, InputQueue &queue, const CancellationToken &stop);
+void writeStats(const char *path, const World &world, const Renderer &renderer, const ProfiledMutex &lock);
+void simulationLoop(World &world, InputQueue &queue, SnapshotExchange &exchange, Recorder *recorder,
+                    CancellationToken &stop);
+bool loadRecording(const char *path, Recording &recording);
+uint64_t worldChecksum(const World &world);
+template <typename Table>
+void writeTable(FILE *file, const Table &table);
+template <typename Table>
+bool readTable(SaveReader &reader, Table &table, int maxRows);
+bool saveWorld(const char *path, const World &world);
+template <typename Table>
+bool spritesAre(const Table &table, SpriteId id);
+bool savedWorldValid(const World &world);
+bool readWorld(SaveReader &reader, World &world);
+bool loadWorld(const char *path, World &world, std::string &error);
+int autopilotKey(const World &world, int index);
+void attachScheduler(World &world, int workers, std::unique_ptr<JobSystem> &jobs,
+                     std::unique_ptr<TickScheduler> &scheduler);
+void fillForStress(World &world);
+int runHeadless(const Options &options);
+int runDepotBench(const Options &options);
+int runMoveBench();
+void initColors();
+int runBenchmarks(const Options &options);
+int runReplay(const Options &options);
+bool loadConfig(const char *path, Options &options, char *program);
+int boundedValue(const char *text, int limit);
+bool parseOptions(int argc, char **argv, Options &options);
+void applyFieldOptions(const Options &options, int terminalColumns, int terminalRows);
+void onTerminalResize(int);
+bool syncTerminalSize(Renderer &renderer);
+
+// **Implementações das Funções**
+
+void FrameBuffer::resize(int newColumns, int newRows)
+{
+    columns = newColumns;
+    rows = newRows;
+    cells.assign(columns * rows, Cell{' ', PAIR_SKY});
+}
+
+void FrameBuffer::putString(int x, int y, const char *text)
+{
+    if (y < 0 || y >= rows)
+        return;
+    for (; *text; text++, x++)
+    {
+        // Espaços são transparentes: o fundo continua aparecendo
+        if (*text == ' ' || x < 0 || x >= columns)
+            continue;
+        at(x, y) = {*text, originY + y < height / 3 ? PAIR_SKY_INK : PAIR_GRASS_INK};
+    }
+}
+
+void drawSprite(FrameBuffer &frame, const Sprite &sprite, int x, int y)
+{
+    x -= frame.originX;
+    for (int r = 0; r < sprite.height; r++)
+    {
+        int row = y + r - frame.originY;
+        if (row < 0 || row >= frame.rows)
+            continue;
+        short ink = y + r < height / 3 ? PAIR_SKY_INK : PAIR_GRASS_INK;
+        // Percorre só as células opacas da máscara
+        for (uint64_t bits = sprite.mask[r]; bits; bits &= bits - 1)
+        {
+            int c = __builtin_ctzll(bits);
+            if (x + c >= 0 && x + c < frame.columns)
+                frame.at(x + c, row) = {sprite.rows[r][c], ink};
+        }
+    }
+}
+
+void drawSkyAndGrass(FrameBuffer &frame)
+{
+    for (int y = 0; y < frame.rows; y++)
+    {
+        Cell background = {' ', frame.originY + y < height / 3 ? PAIR_SKY : PAIR_GRASS}; // Céu ou grama
+        std::fill(frame.cells.begin() + y * frame.columns, frame.cells.begin() + (y + 1) * frame.columns, background);
+    }
+}
+
+const Sprite &spriteFor(SpriteId id, bool movingRight)
+{
+    switch (id)
+    {
+    case SpriteId::Dino:
+        return movingRight ? SPRITE_DINO_RIGHT : SPRITE_DINO_LEFT;
+    case SpriteId::Missile:
+        return SPRITE_MISSILE;
+    case SpriteId::Helicopter:
+        return movingRight ? SPRITE_HELICOPTER_RIGHT : SPRITE_HELICOPTER_LEFT;
+    case SpriteId::Truck:
+        break;
+    }
+    return movingRight ? SPRITE_TRUCK_RIGHT : SPRITE_TRUCK_LEFT;
+}
+
+// Sistema de desenho: serve para qualquer tabela com posição, velocidade e sprite
+template <typename Table>
+void drawEntities(FrameBuffer &frame, const Table &table)
+{
+    const std::vector<Position> &position = table.template column<Position>();
+    const std::vector<Velocity> &velocity = table.template column<Velocity>();
+    const std::vector<SpriteId> &sprite = table.template column<SpriteId>();
+    for (int i = 0; i < table.size(); i++)
+        drawSprite(frame, spriteFor(sprite[i], velocity[i].dx > 0), position[i].x, position[i].y);
+}
+
+void drawDeposit(FrameBuffer &frame, int x, int y)
+{
+    drawSprite(frame, SPRITE_DEPOSIT, x, y);
+}
+
+void Renderer::resize(int terminalColumns, int terminalRows)
+{
+    int columns = std::min(terminalColumns, width);
+    int rows = std::min(terminalRows, height);
+    back.resize(columns, rows);
+    front.resize(columns, rows);
+    run.resize(columns);
+    fullRedraw = true;
+}
+
+void Renderer::compose(const WorldSnapshot &snap)
+{
+    // Centraliza o helicóptero sem sair do campo
+    const Position &helicopter = snap.helicopters.column<Position>()[0];
+    back.originX = std::max(0, std::min(helicopter.x + HELICOPTER_WIDTH / 2 - back.columns / 2, width - back.columns));
+    back.originY = std::max(0, std::min(helicopter.y + HELICOPTER_HEIGHT / 2 - back.rows / 2, height - back.rows));
+
+    drawSkyAndGrass(back);
+    drawDeposit(back, snap.depot.x, snap.depot.y);
+    drawEntities(back, snap.dinos);
+    drawEntities(back, snap.trucks);
+    drawEntities(back, snap.missiles);
+    drawEntities(back, snap.helicopters);
+
+    if (snap.gameOver)
+    {
+        back.putString(back.columns / 2 - 5, back.rows / 2, "GAME OVER");
+        back.putString(back.columns / 2 - 20, back.rows / 2 + 2, "Tecla: nova rodada   m: menu   q: sair");
+    }
+
+    // Exibir informações
+    char line[128];
+    const Ammo &ammo = snap.helicopters.column<Ammo>()[0];
+    snprintf(line, sizeof(line), "Mísseis do helicóptero: %d/%d", ammo.missiles, ammo.capacity);
+    back.hud[0] = line;
+    snprintf(line, sizeof(line), "Mísseis do depósito: %d/%d", snap.depot.missiles.size(), MAX_DEPOT_MISSILES);
+    back.hud[1] = line;
+    back.hud[2] = snap.message;
+    back.hud[3] = snap.truckMessage;
+
+    if (snap.showStats && watchedLock)
+        drawStats(snap);
+}
+
+void Renderer::drawStats(const WorldSnapshot &snap)
+{
+    const int x = back.columns - 42;
+    int y = 0;
+    char line[64];
+    auto row = [&](const char *name, const LatencySummary &stats)
+    {
+        snprintf(line, sizeof(line), "%-8s %7.1f %7.1f %8.1f", name, stats.p50, stats.p99, stats.max);
+        back.putString(x, y++, line);
+    };
+
+    back.putString(x, y++, "us         p50     p99      max");
+    row("tick", snap.tickTimes);
+    row("dinos", snap.dinoTimes);
+    row("misseis", snap.missileTimes);
+    row("quadro", frameTimes.summary());
+
+    const ProfiledMutex &lock = *watchedLock;
+    snprintf(line, sizeof(line), "trava: %lu aq, %lu esperas, %.0f us esp",
+             lock.total(&LockCounters::acquisitions), lock.total(&LockCounters::contended),
+             lock.total(&LockCounters::waitNanos) / 1000.0);
+    back.putString(x, y++, line);
+    snprintf(line, sizeof(line), "threads vivas: %d", threads.alive.load());
+    back.putString(x, y++, line);
+    snprintf(line, sizeof(line), "quadros: %.1f/%d q/s, %ld perdidos", pacer.fps, pacer.targetFps, pacer.dropped);
+    back.putString(x, y++, line);
+}
+
+void Renderer::present()
+{
+    const int columns = back.columns;
+    for (int y = 0; y < back.rows; y++)
+    {
+        // Linhas com HUD são reescritas inteiras quando algo nelas muda,
+        // já que o texto se sobrepõe às células
+        bool hudRow = y < HUD_LINES;
+        bool rowDirty = fullRedraw;
+        if (hudRow && !rowDirty)
+        {
+            rowDirty = back.hud[y] != front.hud[y] ||
+                       !std::equal(back.cells.begin() + y * columns, back.cells.begin() + (y + 1) * columns,
+                                   front.cells.begin() + y * columns);
+            if (!rowDirty)
+                continue;
+        }
+
+        int x = 0;
+        while (x < columns)
+        {
+            if (!rowDirty && back.at(x, y) == front.at(x, y))
+            {
+                x++;
+                continue;
+            }
+
+            // Junta células alteradas vizinhas com a mesma cor em uma só escrita
+            short pair = back.at(x, y).pair;
+            int start = x;
+            int length = 0;
+            while (x < columns && back.at(x, y).pair == pair &&
+                   (rowDirty || back.at(x, y) != front.at(x, y)))
+            {
+                run[length++] = back.at(x, y).ch;
+                x++;
+            }
+            attrset(COLOR_PAIR(pair));
+            mvaddnstr(y, start, run.data(), length);
+        }
+
+        if (hudRow && !back.hud[y].empty())
+        {
+            attrset(COLOR_PAIR(PAIR_SKY_INK));
+            mvaddstr(y, 0, back.hud[y].c_str());
+        }
+    }
+
+    wnoutrefresh(stdscr);
+    doupdate();
+
+    front.cells = back.cells;
+    front.hud = back.hud;
+    fullRedraw = false;
+}
+
+void FramePacer::setTarget(int framesPerSecond)
+{
+    targetFps = framesPerSecond;
+    period = std::chrono::nanoseconds(1000000000 / framesPerSecond);
+}
+
+void FramePacer::start()
+{
+    next = roundStart = windowStart = Clock::now();
+    windowFrames = 0;
+}
+
+Clock::time_point FramePacer::advance()
+{
+    next += period;
+    auto now = Clock::now();
+    if (next <= now)
+    {
+        long missed = (now - next) / period + 1;
+        dropped += missed;
+        next += missed * period;
+    }
+    return next;
+}
+
+void FramePacer::framePresented(Clock::time_point when)
+{
+    presented++;
+    windowFrames++;
+    std::chrono::duration<float> window = when - windowStart;
+    if (window.count() >= 1)
+    {
+        fps = windowFrames / window.count();
+        windowStart = when;
+        windowFrames = 0;
+    }
+}
+
+void FramePacer::stop()
+{
+    active += Clock::now() - roundStart;
+}
+
+float FramePacer::averageFps() const
+{
+    std::chrono::duration<float> seconds = active;
+    return seconds.count() > 0 ? presented / seconds.count() : 0;
+}
+
+int consumeSteps(Duration &accumulator, Duration dt, Duration period)
+{
+    accumulator += dt;
+    int steps = accumulator / period;
+    accumulator -= steps * period;
+    return steps;
+}
+
+bool isHelicopterAtDepot(const Helicopter &helicopter, const Depot &depot)
+{
+    // Verificar sobreposição com a área do desenho do depósito
+    return (helicopter.x + HELICOPTER_WIDTH >= depot.x &&
+            helicopter.x <= depot.x + SPRITE_DEPOSIT.width &&
+            helicopter.y + HELICOPTER_HEIGHT >= depot.y &&
+            helicopter.y <= depot.y + SPRITE_DEPOSIT.height);
+}
+
+const Sprite &dinoSprite(const Dino &dino)
+{
+    return dino.movingRight ? SPRITE_DINO_RIGHT : SPRITE_DINO_LEFT;
+}
+
+// Verdadeiro se a célula (x, y) cai numa célula opaca das linhas
+// [firstRow, lastRow) do sprite desenhado em (spriteX, spriteY)
+bool spriteCellOpaque(const Sprite &sprite, int spriteX, int spriteY, int x, int y, int firstRow, int lastRow)
+{
+    int row = y - spriteY;
+    int column = x - spriteX;
+    const Box &box = sprite.bounds;
+    if (row < std::max(firstRow, box.y) || row >= std::min(lastRow, box.y + box.height) || column < box.x ||
+        column >= box.x + box.width)
+        return false;
+    return (sprite.mask[row] >> column) & 1;
+}
+
+// Sobreposição exata de dois sprites: descarta pelas caixas das células
+// opacas em x e y; senão alinha as máscaras de cada linha em comum com um
+// deslocamento e faz um único AND de 64 bits por linha
+bool spritesOverlap(const Sprite &a, int ax, int ay, const Sprite &b, int bx, int by)
+{
+    int firstX = std::max(ax + a.bounds.x, bx + b.bounds.x);
+    int lastX = std::min(ax + a.bounds.x + a.bounds.width, bx + b.bounds.x + b.bounds.width);
+    int firstY = std::max(ay + a.bounds.y, by + b.bounds.y);
+    int lastY = std::min(ay + a.bounds.y + a.bounds.height, by + b.bounds.y + b.bounds.height);
+    if (firstX >= lastX || firstY >= lastY)
+        return false;
+
+    int shift = bx - ax; // Posição de b nas colunas de a
+    for (int y = firstY; y < lastY; y++)
+    {
+        uint64_t rowA = a.mask[y - ay];
+        uint64_t rowB = b.mask[y - by];
+        if (shift >= 0 ? (rowA & (rowB << shift)) : ((rowA << -shift) & rowB))
+            return true;
+    }
+    return false;
+}
+
+// Primeira célula opaca do dinossauro no trecho da linha do míssil entre
+// fromX e missile.x, na ordem do voo; -1 se o trecho passa livre. O trecho
+// vira uma máscara de colunas do sprite e um único AND acha o que foi cruzado.
+int sweepMissileAgainstDino(const Missile &missile, int fromX, const Dino &dino)
+{
+    if (!dino.alive)
+        return -1;
+
+    const Sprite &sprite = dinoSprite(dino);
+    const Box &box = sprite.bounds;
+    int row = missile.y - dino.y;
+    if (row < box.y || row >= box.y + box.height)
+        return -1;
+
+    int first = std::max(std::min(fromX, missile.x) - dino.x, box.x);
+    int last = std::min(std::max(fromX, missile.x) - dino.x, box.x + box.width - 1);
+    if (first > last)
+        return -1;
+
+    uint64_t span = (~0ull >> (63 - last)) & (~0ull << first);
+    uint64_t crossed = sprite.mask[row] & span;
+    if (!crossed)
+        return -1;
+    int column = missile.movingRight ? __builtin_ctzll(crossed) : 63 - __builtin_clzll(crossed);
+    return dino.x + column;
+}
+
+bool checkCollisionWithDinoHead(const Missile &missile, Dino &dino, int headshotsToKill)
+{
+    if (!dino.alive)
+        return false;
+
+    // Verificar colisão com as células da cabeça
+    if (spriteCellOpaque(dinoSprite(dino), dino.x, dino.y, missile.x, missile.y, 0, DINO_HEAD_ROWS))
+    {
+        dino.headshotHits++;
+        if (dino.headshotHits >= headshotsToKill)
+        {
+            dino.alive = false;
+        }
+        return true;
+    }
+    return false;
+}
+
+bool checkCollisionWithDinoBody(const Missile &missile, const Dino &dino)
+{
+    if (!dino.alive)
+        return false;
+
+    // Verificar colisão com as células do corpo
+    return spriteCellOpaque(dinoSprite(dino), dino.x, dino.y, missile.x, missile.y, DINO_HEAD_ROWS, MAX_SPRITE_ROWS);
+}
+
+bool checkCollisionWithHelicopter(const Helicopter &helicopter, const Dino &dino)
+{
+    // Verificar colisão entre as células do helicóptero e do dinossauro
+    const Sprite &helicopterSprite = helicopter.movingRight ? SPRITE_HELICOPTER_RIGHT : SPRITE_HELICOPTER_LEFT;
+    return spritesOverlap(helicopterSprite, helicopter.x, helicopter.y, dinoSprite(dino), dino.x, dino.y);
+}
+
+int countAliveDinos(const DinoTable &dinos)
+{
+    return dinos.size();
+}
+
+Dino dinoAt(const DinoTable &dinos, int i)
+{
+    const Position &position = dinos.column<Position>()[i];
+    return {position.x, position.y, true, dinos.column<Velocity>()[i].dx > 0,
+            dinos.column<Health>()[i].headshotHits};
+}
+
+Missile missileAt(const MissileTable &missiles, int i)
+{
+    const Position &position = missiles.column<Position>()[i];
+    return {position.x, position.y, true, missiles.column<Velocity>()[i].dx > 0};
+}
+
+Helicopter helicopterAt(const HelicopterTable &helicopters, int i)
+{
+    const Position &position = helicopters.column<Position>()[i];
+    const Ammo &ammo = helicopters.column<Ammo>()[i];
+    return {position.x, position.y, helicopters.column<Velocity>()[i].dx > 0,
+            helicopters.column<Pilot>()[i].state, ammo.missiles, ammo.capacity};
+}
+
+void SpatialGrid::cellRange(const Position &position, int &x0, int &x1, int &y0, int &y1) const
+{
+    int left = position.x + DINO_BOUNDS.x, top = position.y + DINO_BOUNDS.y;
+    x0 = std::max(left, 0) / GRID_CELL;
+    x1 = std::min(left + DINO_BOUNDS.width - 1, width - 1) / GRID_CELL;
+    y0 = std::max(top, 0) / GRID_CELL;
+    y1 = std::min(top + DINO_BOUNDS.height - 1, height - 1) / GRID_CELL;
+}
+
+void SpatialGrid::build(const DinoTable &dinos)
+{
+    const std::vector<Position> &position = dinos.column<Position>();
+    // O campo não muda durante a partida: depois da primeira vez,
+    // assign só zera a memória que já existe
+    columns = (width + GRID_CELL - 1) / GRID_CELL;
+    rows = (height + GRID_CELL - 1) / GRID_CELL;
+    int cells = columns * rows;
+
+    // Contar entradas por célula
+    cellStart.assign(cells + 1, 0);
+    int x0, x1, y0, y1;
+    for (int i = 0; i < dinos.size(); i++)
+    {
+        cellRange(position[i], x0, x1, y0, y1);
+        for (int cy = y0; cy <= y1; cy++)
+            for (int cx = x0; cx <= x1; cx++)
+                cellStart[cy * columns + cx + 1]++;
+    }
+
+    // Soma de prefixos: cellStart[c] passa a ser o início da célula c
+    for (int c = 0; c < cells; c++)
+        cellStart[c + 1] += cellStart[c];
+
+    // Preencher usando cursores por célula
+    entries.resize(cellStart[cells]);
+    cursor.assign(cellStart.begin(), cellStart.end() - 1);
+    for (int i = 0; i < dinos.size(); i++)
+    {
+        cellRange(position[i], x0, x1, y0, y1);
+        for (int cy = y0; cy <= y1; cy++)
+            for (int cx = x0; cx <= x1; cx++)
+                entries[cursor[cy * columns + cx]++] = i;
+    }
+}
+
+void SpatialGrid::removeSwapped(int index, const Position &removed, int last, const Position &moved)
+{
+    int x0, x1, y0, y1;
+    cellRange(removed, x0, x1, y0, y1);
+    for (int cy = y0; cy <= y1; cy++)
+        for (int cx = x0; cx <= x1; cx++)
+        {
+            int cell = cy * columns + cx;
+            for (int k = cellStart[cell]; k < cellStart[cell + 1]; k++)
+                if (entries[k] == index)
+                    entries[k] = -1;
+        }
+    if (last == index)
+        return;
+
+    // A linha movida ganha um índice menor: anda para a frente na célula
+    // até a ordem crescente voltar; passar por um -1 não muda essa ordem
+    cellRange(moved, x0, x1, y0, y1);
+    for (int cy = y0; cy <= y1; cy++)
+        for (int cx = x0; cx <= x1; cx++)
+        {
+            int cell = cy * columns + cx;
+            int k = cellStart[cell];
+            while (entries[k] != last)
+                k++;
+            entries[k] = index;
+            for (; k > cellStart[cell] && (entries[k - 1] < 0 || entries[k - 1] > index); k--)
+                std::swap(entries[k - 1], entries[k]);
+        }
+}
+
+void SpatialGrid::reserve(int maxDinos)
+{
+    int cells = ((width + GRID_CELL - 1) / GRID_CELL) * ((height + GRID_CELL - 1) / GRID_CELL);
+    int cellsPerDino =
+        ((DINO_BOUNDS.width + GRID_CELL - 2) / GRID_CELL + 1) * ((DINO_BOUNDS.height + GRID_CELL - 2) / GRID_CELL + 1);
+    cellStart.reserve(cells + 1);
+    cursor.reserve(cells);
+    entries.reserve(maxDinos * cellsPerDino);
+}
+
+int SpatialGrid::cellAt(int x, int y) const
+{
+    if (x < 0 || x >= width || y < 0 || y >= height)
+        return -1;
+    return (y / GRID_CELL) * columns + x / GRID_CELL;
+}
+
+// **Instrumentação**
+
+// Fora de linha: inlinhados, o GCC confunde o par com o new/delete
+// padrão e acusa -Wmismatched-new-delete nos chamadores
+__attribute__((noinline)) void *operator new(size_t size)
+{
+    heapAllocations.fetch_add(1, std::memory_order_relaxed);
+    if (void *block = malloc(size ? size : 1))
+        return block;
+    throw std::bad_alloc();
+}
+
+__attribute__((noinline)) void operator delete(void *block) noexcept
+{
+    free(block);
+}
+
+__attribute__((noinline)) void operator delete(void *block, size_t) noexcept
+{
+    free(block);
+}
+
+// Tipos com alignas maior que o do malloc (filas, depósito, mundo, quadro)
+// passam por estas; sem elas um new desses tipos não seria contado
+__attribute__((noinline)) void *operator new(size_t size, std::align_val_t alignment)
+{
+    heapAllocations.fetch_add(1, std::memory_order_relaxed);
+    void *block;
+    if (posix_memalign(&block, std::max((size_t)alignment, sizeof(void *)), size ? size : 1) == 0)
+        return block;
+    throw std::bad_alloc();
+}
+
+__attribute__((noinline)) void operator delete(void *block, std::align_val_t) noexcept
+{
+    free(block);
+}
+
+__attribute__((noinline)) void operator delete(void *block, size_t, std::align_val_t) noexcept
+{
+    free(block);
+}
+
+float elapsedMicros(Clock::time_point start)
+{
+    return std::chrono::duration<float, std::micro>(Clock::now() - start).count();
+}
+
+void LatencyStats::add(float micros)
+{
+    samples[count % STATS_WINDOW] = micros;
+    count++;
+    total += micros;
+    max = std::max(max, micros);
+}
+
+LatencySummary LatencyStats::summary() const
+{
+    LatencySummary result;
+    result.count = count;
+    if (count == 0)
+        return result;
+
+    int n = (int)std::min<long>(count, STATS_WINDOW);
+    std::array<float, STATS_WINDOW> sorted{};
+    std::copy(samples.begin(), samples.begin() + n, sorted.begin());
+    std::nth_element(sorted.begin(), sorted.begin() + n / 2, sorted.begin() + n);
+    result.p50 = sorted[n / 2];
+    std::nth_element(sorted.begin(), sorted.begin() + n * 99 / 100, sorted.begin() + n);
+    result.p99 = sorted[n * 99 / 100];
+    result.max = max;
+    result.mean = total / count;
+    return result;
+}
+
+ThreadScope::ThreadScope(const char *name)
+{
+    threadSlot = std::min(threads.registered.fetch_add(1), MAX_THREADS - 1);
+    threads.names[threadSlot] = name;
+    threads.alive++;
+}
+
+ThreadScope::~ThreadScope()
+{
+    threads.alive--;
+}
+
+void ProfiledMutex::lock()
+{
+    LockCounters &mine = counters();
+    if (!mutex.try_lock())
+    {
+        auto start = Clock::now();
+        mutex.lock();
+        mine.contended.fetch_add(1, std::memory_order_relaxed);
+        mine.waitNanos.fetch_add(std::chrono::nanoseconds(Clock::now() - start).count(), std::memory_order_relaxed);
+    }
+    mine.acquisitions.fetch_add(1, std::memory_order_relaxed);
+    lockedAt = Clock::now();
+}
+
+void ProfiledMutex::unlock()
+{
+    counters().holdNanos.fetch_add(std::chrono::nanoseconds(Clock::now() - lockedAt).count(), std::memory_order_relaxed);
+    mutex.unlock();
+}
+
+unsigned long ProfiledMutex::total(std::atomic<unsigned long> LockCounters::*field) const
+{
+    unsigned long sum = 0;
+    for (const auto &counters : perThread)
+        sum += (counters.*field).load(std::memory_order_relaxed);
+    return sum;
+}
+
+// **Sistema de Tarefas**
+
+Job &JobGraph::add(void (*run)(void *context), void *context)
+{
+    Job &job = jobs[count++];
+    job.run = run;
+    job.context = context;
+    job.graph = this;
+    return job;
+}
+
+void JobGraph::depend(Job &before, Job &after)
+{
+    before.successors[before.successorCount++] = &after;
+    after.dependencyCount++;
+}
+
+bool WorkQueue::push(Job *job)
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    if (tail - head == WORK_QUEUE_SIZE)
+        return false;
+    jobs[tail++ & (WORK_QUEUE_SIZE - 1)] = job;
+    return true;
+}
+
+Job *WorkQueue::pop()
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    if (head == tail)
+        return nullptr;
+    return jobs[--tail & (WORK_QUEUE_SIZE - 1)];
+}
+
+Job *WorkQueue::steal()
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    if (head == tail)
+        return nullptr;
+    return jobs[head++ & (WORK_QUEUE_SIZE - 1)];
+}
+
+JobSystem::JobSystem(int workerCount)
+{
+    total = std::max(0, std::min(workerCount, MAX_WORKERS));
+    for (int i = 0; i < total; i++)
+        workers.emplace_back(&JobSystem::workerLoop, this, i);
+}
+
+JobSystem::~JobSystem()
+{
+    {
+        std::lock_guard<std::mutex> lock(sleepMutex);
+        stopping = true;
+    }
+    wakeUp.notify_all();
+    for (auto &worker : workers)
+        worker.join();
+}
+
+void JobSystem::run(JobGraph &graph)
+{
+    // Quem chama usa a fila extra, depois das dos trabalhadores
+    int self = workerCount();
+    workerIndex = self;
+
+    graph.remaining.store(graph.count, std::memory_order_relaxed);
+    for (int i = 0; i < graph.count; i++)
+        graph.jobs[i].unfinishedDependencies.store(graph.jobs[i].dependencyCount, std::memory_order_relaxed);
+    for (int i = 0; i < graph.count; i++)
+    {
+        if (graph.jobs[i].dependencyCount == 0)
+            submit(&graph.jobs[i]);
+    }
+
+    // Ajuda a executar até o grafo terminar
+    while (graph.remaining.load(std::memory_order_acquire) > 0)
+    {
+        Job *job = findJob(self);
+        if (job)
+            execute(job);
+        else
+            std::this_thread::yield();
+    }
+}
+
+void JobSystem::workerLoop(int index)
+{
+    ThreadScope scope("tarefas");
+    workerIndex = index;
+    while (!stopping)
+    {
+        Job *job = findJob(index);
+        if (job)
+        {
+            execute(job);
+            continue;
+        }
+
+        // Sem trabalho: dorme até alguém enfileirar uma tarefa
+        std::unique_lock<std::mutex> lock(sleepMutex);
+        sleepers++;
+        wakeUp.wait(lock, [this] { return stopping || queued > 0; });
+        sleepers--;
+    }
+}
+
+void JobSystem::submit(Job *job)
+{
+    if (!queues[workerIndex].push(job))
+    {
+        execute(job); // Fila cheia: roda na hora
+        return;
+    }
+    queued++;
+    if (sleepers > 0)
+    {
+        // Pega a trava para não perder o aviso de quem está indo dormir
+        {
+            std::lock_guard<std::mutex> lock(sleepMutex);
+        }
+        wakeUp.notify_one();
+    }
+}
+
+void JobSystem::execute(Job *job)
+{
+    job->run(job->context);
+    for (int i = 0; i < job->successorCount; i++)
+    {
+        Job *next = job->successors[i];
+        if (next->unfinishedDependencies.fetch_sub(1, std::memory_order_acq_rel) == 1)
+            submit(next);
+    }
+    job->graph->remaining.fetch_sub(1, std::memory_order_release);
+}
+
+Job *JobSystem::findJob(int index)
+{
+    int queueCount = workerCount() + 1;
+    Job *job = queues[index].pop();
+    for (int k = 1; !job && k < queueCount; k++)
+        job = queues[(index + k) % queueCount].steal();
+    if (job)
+        queued--;
+    return job;
+}
+
+TickScheduler::TickScheduler(JobSystem &jobs, World &world) : jobs(jobs)
+{
+    int count = jobs.workerCount() + 1;
+    for (int i = 0; i < count; i++)
+        chunks[i] = {&world, i, count};
+
+    auto stage = [this](void (*run)(void *), void *context) -> Job & { return graph.add(run, context); };
+    Job &spawn = stage([](void *w) { static_cast<World *>(w)->spawnStage(); }, &world);
+    Job &finish = stage([](void *c)
+                        {
+                            DinoChunk *chunk = static_cast<DinoChunk *>(c);
+                            chunk->world->finishDinoStage(chunk->count);
+                        },
+                        &chunks[0]);
+    for (int i = 0; i < count; i++)
+    {
+        Job &move = stage([](void *c)
+                          {
+                              DinoChunk *chunk = static_cast<DinoChunk *>(c);
+                              chunk->world->moveDinoChunk(chunk->index, chunk->count);
+                          },
+                          &chunks[i]);
+        graph.depend(spawn, move);
+        graph.depend(move, finish);
+    }
+    Job &missiles = stage([](void *w) { static_cast<World *>(w)->missileStage(); }, &world);
+    graph.depend(finish, missiles);
+
+    stage([](void *w) { static_cast<World *>(w)->timerStage(); }, &world);
+}
+
+// **Roda de Eventos**
+
+TimerWheel::TimerWheel()
+{
+    slots.fill(-1);
+    for (int i = 0; i < MAX_TIMERS; i++)
+        timers[i].next = i + 1 < MAX_TIMERS ? i + 1 : -1;
+}
+
+int TimerWheel::schedule(long due, TimerEvent event, int subject)
+{
+    int timer = freeList;
+    if (timer < 0)
+    {
+        fprintf(stderr, "Roda de eventos cheia\n");
+        abort();
+    }
+    freeList = timers[timer].next;
+
+    // Entra no fim do balde para que eventos do mesmo tick saiam na ordem
+    timers[timer] = {due, event, subject, -1};
+    int *link = &slots[due & (TIMER_SLOTS - 1)];
+    while (*link >= 0)
+        link = &timers[*link].next;
+    *link = timer;
+    return timer;
+}
+
+void TimerWheel::cancel(int timer)
+{
+    // Tira o nó do balde na hora, para que idas e vindas não esgotem a roda
+    int *link = &slots[timers[timer].due & (TIMER_SLOTS - 1)];
+    while (*link != timer)
+        link = &timers[*link].next;
+    *link = timers[timer].next;
+    timers[timer].next = freeList;
+    freeList = timer;
+}
+
+template <typename Handler>
+void TimerWheel::expire(long tick, Handler &&handler)
+{
+    // Desencadeia primeiro: o tratamento pode agendar no mesmo balde
+    std::array<int, MAX_TIMERS> due;
+    int count = 0;
+    for (int *link = &slots[tick & (TIMER_SLOTS - 1)]; *link >= 0;)
+    {
+        int timer = *link;
+        if (timers[timer].due > tick)
+        {
+            link = &timers[timer].next;
+            continue;
+        }
+        *link = timers[timer].next;
+        due[count++] = timer;
+    }
+
+    for (int i = 0; i < count; i++)
+    {
+        Timer fired = timers[due[i]];
+        timers[due[i]].next = freeList;
+        freeList = due[i];
+        handler(fired.event, fired.subject);
+    }
+}
+
+bool TimerWheel::valid(long tick) const
+{
+    std::array<bool, MAX_TIMERS> seen{};
+    int reached = 0;
+    // Percorre uma lista; um nó repetido é ciclo ou lista cruzada
+    auto walk = [&](int head, int slot)
+    {
+        for (int timer = head; timer != -1; timer = timers[timer].next)
+        {
+            if (timer < 0 || timer >= MAX_TIMERS || seen[timer])
+                return false;
+            seen[timer] = true;
+            reached++;
+            if (slot < 0)
+                continue;
+            const Timer &node = timers[timer];
+            if ((node.due & (TIMER_SLOTS - 1)) != slot || node.due < tick || node.event < TimerEvent::TruckDeparts ||
+                node.event > TimerEvent::ReloadDone)
+                return false;
+        }
+        return true;
+    };
+
+    for (int slot = 0; slot < TIMER_SLOTS; slot++)
+        if (!walk(slots[slot], slot))
+            return false;
+    return walk(freeList, -1) && reached == MAX_TIMERS;
+}
+
+bool TimerWheel::scheduled(int timer) const
+{
+    for (int node = slots[timers[timer].due & (TIMER_SLOTS - 1)]; node >= 0; node = timers[node].next)
+        if (node == timer)
+            return true;
+    return false;
+}
+
+// **Movimento em Lote**
+// Um passo de movimento para um intervalo de linhas de uma tabela: soma
+// dx ao x e, no quique, vira a velocidade de quem passou de maxX andando
+// para a direita ou de 0 andando para a esquerda. As versões vetoriais
+// fazem 8 linhas por vez com AVX2 ou 4 com SSE2 (compilação com -mavx2 ou
+// padrão x86-64); o resto do intervalo e as outras arquiteturas usam o laço
+// escalar. Só há soma e comparação de inteiros, então o resultado é o
+// mesmo nas três versões.
+static_assert(sizeof(Position) == 2 * sizeof(int) && sizeof(Velocity) == sizeof(int), "Colunas lidas como int");
+
+void moveEntitiesScalar(Position *position, const Velocity *velocity, int begin, int end)
+{
+    for (int i = begin; i < end; i++)
+        position[i].x += velocity[i].dx;
+}
+
+void moveAndBounceScalar(Position *position, Velocity *velocity, int begin, int end, int maxX)
+{
+    for (int i = begin; i < end; i++)
+    {
+        position[i].x += velocity[i].dx;
+        if (velocity[i].dx > 0 && position[i].x > maxX)
+            velocity[i].dx = -1;
+        else if (velocity[i].dx < 0 && position[i].x < 0)
+            velocity[i].dx = 1;
+    }
+}
+
+#if defined(__AVX2__)
+
+const char *movementKernel()
+{
+    return "avx2";
+}
+
+// Velocidades de 8 linhas intercaladas com zero, no formato de duas
+// cargas de 4 posições: [d0 0 d1 0 | d2 0 d3 0] e [d4 0 d5 0 | d6 0 d7 0]
+static inline void spreadVelocity(__m256i d, __m256i &low, __m256i &high)
+{
+    __m256i order = _mm256_permutevar8x32_epi32(d, _mm256_setr_epi32(0, 1, 4, 5, 2, 3, 6, 7));
+    low = _mm256_unpacklo_epi32(order, _mm256_setzero_si256());
+    high = _mm256_unpackhi_epi32(order, _mm256_setzero_si256());
+}
+
+void moveEntities(Position *position, const Velocity *velocity, int begin, int end)
+{
+    int i = begin;
+    for (; i + 8 <= end; i += 8)
+    {
+        __m256i low, high;
+        spreadVelocity(_mm256_loadu_si256((const __m256i *)(velocity + i)), low, high);
+        __m256i *p = (__m256i *)(position + i);
+        _mm256_storeu_si256(p, _mm256_add_epi32(_mm256_loadu_si256(p), low));
+        _mm256_storeu_si256(p + 1, _mm256_add_epi32(_mm256_loadu_si256(p + 1), high));
+    }
+    moveEntitiesScalar(position, velocity, i, end);
+}
+
+void moveAndBounce(Position *position, Velocity *velocity, int begin, int end, int maxX)
+{
+    const __m256i zero = _mm256_setzero_si256();
+    const __m256i one = _mm256_set1_epi32(1);
+    const __m256i limit = _mm256_set1_epi32(maxX);
+    int i = begin;
+    for (; i + 8 <= end; i += 8)
+    {
+        __m256i d = _mm256_loadu_si256((const __m256i *)(velocity + i));
+        __m256i low, high;
+        spreadVelocity(d, low, high);
+        __m256i *p = (__m256i *)(position + i);
+        __m256i p0 = _mm256_add_epi32(_mm256_loadu_si256(p), low);
+        __m256i p1 = _mm256_add_epi32(_mm256_loadu_si256(p + 1), high);
+        _mm256_storeu_si256(p, p0);
+        _mm256_storeu_si256(p + 1, p1);
+
+        // Só os x, na ordem das velocidades
+        __m256 pairs = _mm256_shuffle_ps(_mm256_castsi256_ps(p0), _mm256_castsi256_ps(p1), _MM_SHUFFLE(2, 0, 2, 0));
+        __m256i x = _mm256_permute4x64_epi64(_mm256_castps_si256(pairs), _MM_SHUFFLE(3, 1, 2, 0));
+
+        __m256i right = _mm256_and_si256(_mm256_cmpgt_epi32(d, zero), _mm256_cmpgt_epi32(x, limit));
+        __m256i left = _mm256_and_si256(_mm256_cmpgt_epi32(zero, d), _mm256_cmpgt_epi32(zero, x));
+        // right é todo 1 (= -1); left vira +1
+        __m256i turned = _mm256_or_si256(right, _mm256_and_si256(left, one));
+        d = _mm256_or_si256(_mm256_andnot_si256(_mm256_or_si256(right, left), d), turned);
+        _mm256_storeu_si256((__m256i *)(velocity + i), d);
+    }
+    moveAndBounceScalar(position, velocity, i, end, maxX);
+}
+
+#elif defined(__SSE2__)
+
+const char *movementKernel()
+{
+    return "sse2";
+}
+
+void moveEntities(Position *position, const Velocity *velocity, int begin, int end)
+{
+    const __m128i zero = _mm_setzero_si128();
+    int i = begin;
+    for (; i + 4 <= end; i += 4)
+    {
+        __m128i d = _mm_loadu_si128((const __m128i *)(velocity + i));
+        __m128i *p = (__m128i *)(position + i);
+        _mm_storeu_si128(p, _mm_add_epi32(_mm_loadu_si128(p), _mm_unpacklo_epi32(d, zero)));
+        _mm_storeu_si128(p + 1, _mm_add_epi32(_mm_loadu_si128(p + 1), _mm_unpackhi_epi32(d, zero)));
+    }
+    moveEntitiesScalar(position, velocity, i, end);
+}
+
+void moveAndBounce(Position *position, Velocity *velocity, int begin, int end, int maxX)
+{
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i one = _mm_set1_epi32(1);
+    const __m128i limit = _mm_set1_epi32(maxX);
+    int i = begin;
+    for (; i + 4 <= end; i += 4)
+    {
+        __m128i d = _mm_loadu_si128((const __m128i *)(velocity + i));
+        __m128i *p = (__m128i *)(position + i);
+        __m128i p0 = _mm_add_epi32(_mm_loadu_si128(p), _mm_unpacklo_epi32(d, zero));
+        __m128i p1 = _mm_add_epi32(_mm_loadu_si128(p + 1), _mm_unpackhi_epi32(d, zero));
+        _mm_storeu_si128(p, p0);
+        _mm_storeu_si128(p + 1, p1);
+
+        // Só os x, na ordem das velocidades
+        __m128i x = _mm_castps_si128(_mm_shuffle_ps(_mm_castsi128_ps(p0), _mm_castsi128_ps(p1), _MM_SHUFFLE(2, 0, 2, 0)));
+
+        __m128i right = _mm_and_si128(_mm_cmpgt_epi32(d, zero), _mm_cmpgt_epi32(x, limit));
+        __m128i left = _mm_and_si128(_mm_cmplt_epi32(d, zero), _mm_cmplt_epi32(x, zero));
+        // right é todo 1 (= -1); left vira +1
+        __m128i turned = _mm_or_si128(right, _mm_and_si128(left, one));
+        d = _mm_or_si128(_mm_andnot_si128(_mm_or_si128(right, left), d), turned);
+        _mm_storeu_si128((__m128i *)(velocity + i), d);
+    }
+    moveAndBounceScalar(position, velocity, i, end, maxX);
+}
+
+#else
+
+const char *movementKernel()
+{
+    return "escalar";
+}
+
+void moveEntities(Position *position, const Velocity *velocity, int begin, int end)
+{
+    moveEntitiesScalar(position, velocity, begin, end);
+}
+
+void moveAndBounce(Position *position, Velocity *velocity, int begin, int end, int maxX)
+{
+    moveAndBounceScalar(position, velocity, begin, end, maxX);
+}
+
+#endif
+
+// **Simulação**
+
+uint64_t Random::next()
+{
+    uint64_t z = (state += 0x9E3779B97F4A7C15ull);
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+    return z ^ (z >> 31);
+}
+
+World::World(int m, int n, int t, uint64_t seed) : m(m), n(n), t(t), rng{seed}
+{
+    reset(m, n, t, seed);
+}
+
+void World::reset(int m, int n, int t, uint64_t seed)
+{
+    this->m = m;
+    this->n = n;
+    this->t = t;
+    rng = {seed};
+    running = true;
+    gameOver = false;
+    tick = 0;
+
+    // Toda a memória da rodada sai daqui, do tamanho máximo que ela pode
+    // usar; clear() mantém a capacidade para as rodadas seguintes, e o laço
+    // do jogo não aloca mais nada
+    dinos.clear();
+    dinos.reserve(maxAliveDinos);
+    missiles.clear();
+    missiles.reserve(maxMissiles);
+    grid.reserve(maxAliveDinos);
+    message.clear();
+    message.reserve(MAX_MESSAGE);
+    truckMessage.clear();
+    truckMessage.reserve(MAX_MESSAGE);
+    timers = TimerWheel();
+    depot = Depot();
+    spawnTimer = dinoTimer = missileTimer = Duration(0);
+    pendingSpawns = pendingDinoSteps = pendingMissileSteps = 0;
+    chunkHitHelicopter.fill(false);
+
+    // Os pilotos automáticos começam lado a lado com o jogador
+    helicopters.clear();
+    for (int i = 0; i < helicopterCount; i++)
+        helicopters.add({(40 + 25 * i) % (width - HELICOPTER_WIDTH), 20}, {1}, SpriteId::Helicopter, {n, n},
+                        {HelicopterState::Normal, -1});
+
+    for (int i = 0; i < MAX_DEPOT_MISSILES; i++)
+        depot.missiles.push(-1);
+
+    // Viagens espalhadas pelo intervalo para os caminhões não chegarem juntos
+    trucks.clear();
+    for (int i = 0; i < truckCount; i++)
+    {
+        trucks.add({-TRUCK_WIDTH, height - 10}, {1}, SpriteId::Truck, {TruckState::Waiting});
+        after(TRUCK_TRIP_INTERVAL + TRUCK_TRIP_INTERVAL * i / truckCount, TimerEvent::TruckDeparts, i);
+    }
+}
+
+void World::handleKey(int ch)
+{
+    switch (ch)
+    {
+    case 'p': // Painel de desempenho
+        showStats = !showStats;
+        break;
+    case 'q': // Sair do programa
+        running = false;
+        break;
+    default:
+        controlHelicopter(0, ch);
+        break;
+    }
+}
+
+// Tecla do jogador (helicóptero 0) ou do piloto automático dos outros
+void World::controlHelicopter(int index, int ch)
+{
+    Position &position = helicopters.column<Position>()[index];
+    Velocity &velocity = helicopters.column<Velocity>()[index];
+    Ammo &ammo = helicopters.column<Ammo>()[index];
+    switch (ch)
+    {
+    case KEY_UP:
+        if (position.y > 0)
+        {
+            position.y--;
+            helicopterMoved(index);
+        }
+        break;
+    case KEY_DOWN:
+        if (position.y < height - HELICOPTER_HEIGHT)
+        {
+            position.y++;
+            helicopterMoved(index);
+        }
+        break;
+    case KEY_LEFT:
+        if (position.x > 0)
+        {
+            position.x--;
+            velocity.dx = -1;
+            helicopterMoved(index);
+        }
+        break;
+    case KEY_RIGHT:
+        if (position.x < width - HELICOPTER_WIDTH)
+        {
+            position.x++;
+            velocity.dx = 1;
+            helicopterMoved(index);
+        }
+        break;
+    case ' ': // Disparar míssil
+        if (ammo.missiles > 0)
+        {
+            if (missiles.size() < maxMissiles)
+            {
+                bool movingRight = velocity.dx > 0;
+                missiles.add({position.x + (movingRight ? HELICOPTER_WIDTH : -1), position.y},
+                             {movingRight ? missileSpeed : -missileSpeed}, SpriteId::Missile);
+                ammo.missiles--;
+                tryStartReload(index); // Disparo de dentro do depósito
+            }
+            else
+            {
+                notify(index, "Muitos mísseis em voo!");
+            }
+        }
+        else
+        {
+            notify(index, "Sem mísseis! Reabasteça no depósito.");
+        }
+        break;
+    }
+}
+
+// Só o jogador recebe mensagens; os pilotos automáticos agem calados
+void World::notify(int index, const char *text)
+{
+    if (index == 0)
+        message = text;
+}
+
+void World::step(Duration dt)
+{
+    if (!running || gameOver)
+        return;
+
+    // Intervalo baseado na dificuldade
+    pendingSpawns = consumeSteps(spawnTimer, dt, std::chrono::seconds(t));
+    pendingDinoSteps = consumeSteps(dinoTimer, dt, DINO_STEP);
+    pendingMissileSteps = consumeSteps(missileTimer, dt, MISSILE_STEP);
+
+    tick++;
+
+    // Pilotos automáticos decidem com o estado do fim do tick anterior
+    for (int i = 1; i < (int)helicopters.size(); i++)
+    {
+        int ch = autopilotKey(*this, i);
+        if (ch != ERR)
+            controlHelicopter(i, ch);
+    }
+
+    if (scheduler)
+    {
+        scheduler->run();
+        return;
+    }
+
+    spawnStage();
+    moveDinoChunk(0, 1);
+    finishDinoStage(1);
+    missileStage();
+    timerStage();
+}
+
+void World::spawnStage()
+{
+    for (int i = pendingSpawns; i > 0; i--)
+        spawnDino();
+    if (profiling)
+        dinoStart = Clock::now();
+}
+
+void World::moveDinoChunk(int chunk, int chunks)
+{
+    int begin = dinos.size() * chunk / chunks;
+    int end = dinos.size() * (chunk + 1) / chunks;
+    std::vector<Position> &position = dinos.column<Position>();
+    std::vector<Velocity> &velocity = dinos.column<Velocity>();
+    const std::vector<Health> &health = dinos.column<Health>();
+
+    // Só posição e direção: o estágio dos eventos roda ao mesmo tempo e
+    // escreve Ammo e Pilot dos helicópteros
+    std::array<Helicopter, MAX_HELICOPTERS> pilots{};
+    int pilotCount = helicopters.size();
+    const std::vector<Position> &pilotPosition = helicopters.column<Position>();
+    const std::vector<Velocity> &pilotVelocity = helicopters.column<Velocity>();
+    for (int h = 0; h < pilotCount; h++)
+    {
+        pilots[h].x = pilotPosition[h].x;
+        pilots[h].y = pilotPosition[h].y;
+        pilots[h].movingRight = pilotVelocity[h].dx > 0;
+    }
+
+    bool hitHelicopter = false;
+    for (int step = 0; step < pendingDinoSteps; step++)
+    {
+        // O bloco inteiro anda de uma vez; a colisão de cada um só depende
+        // da própria posição depois do passo
+        moveAndBounce(position.data(), velocity.data(), begin, end, width - 20);
+        for (int i = begin; i < end; i++)
+        {
+            // Verificar colisão com os helicópteros
+            Dino dino = {position[i].x, position[i].y, true, velocity[i].dx > 0, health[i].headshotHits};
+            for (int h = 0; h < pilotCount; h++)
+            {
+                if (checkCollisionWithHelicopter(pilots[h], dino))
+                    hitHelicopter = true;
+            }
+        }
+    }
+    chunkHitHelicopter[chunk] = hitHelicopter;
+}
+
+void World::finishDinoStage(int chunks)
+{
+    if (pendingDinoSteps == 0 || endless)
+        return;
+
+    for (int chunk = 0; chunk < chunks; chunk++)
+    {
+        if (chunkHitHelicopter[chunk])
+            gameOver = true;
+    }
+
+    // Verificar Game Over
+    if (countAliveDinos(dinos) >= maxAliveDinos)
+    {
+        gameOver = true;
+    }
+
+    if (profiling)
+        dinoTimes.add(elapsedMicros(dinoStart));
+}
+
+void World::missileStage()
+{
+    if (pendingMissileSteps == 0 || missiles.size() == 0)
+        return;
+
+    auto start = profiling ? Clock::now() : Clock::time_point();
+    // Os dinossauros não se movem durante os passos dos mísseis
+    grid.build(dinos);
+    for (int i = pendingMissileSteps; i > 0; i--)
+        advanceMissiles();
+    if (profiling)
+        missileTimes.add(elapsedMicros(start));
+}
+
+void World::timerStage()
+{
+    timers.expire(tick, [this](TimerEvent event, int subject) { handleTimer(event, subject); });
+}
+
+void World::spawnDino()
+{
+    if (countAliveDinos(dinos) < maxAliveDinos)
+    {
+        int randomHeight = height - 8 - rng.below(5);
+        dinos.add({0, randomHeight}, {1}, SpriteId::Dino, {0});
+    }
+}
+
+void World::advanceMissiles()
+{
+    std::vector<Position> &position = missiles.column<Position>();
+    const std::vector<Velocity> &velocity = missiles.column<Velocity>();
+    // Todos andam antes das colisões; uma remoção traz para i o último,
+    // que já andou neste passo
+    moveEntities(position.data(), velocity.data(), 0, missiles.size());
+    int i = 0;
+    while (i < missiles.size())
+    {
+        int fromX = position[i].x - velocity[i].dx;
+        Missile missile = missileAt(missiles, i);
+
+        // Trecho percorrido no passo, incluindo a célula de partida: o
+        // dinossauro pode ter andado para cima dela no mesmo tick
+        int first = std::max(std::min(fromX, missile.x), 0);
+        int last = std::min(std::max(fromX, missile.x), width - 1);
+        int firstCell = grid.cellAt(first, missile.y);
+        int lastCell = grid.cellAt(last, missile.y);
+
+        // Só os dinossauros das células da grade cruzadas pelo trecho; vale
+        // o acerto mais próximo do ponto de partida
+        int target = -1;
+        int targetX = 0;
+        for (int cell = firstCell; first <= last && cell >= 0 && cell <= lastCell; cell++)
+        {
+            for (int k = grid.cellStart[cell]; k < grid.cellStart[cell + 1]; k++)
+            {
+                int index = grid.entries[k];
+                if (index < 0) // Morto neste estágio
+                    continue;
+                int hitX = sweepMissileAgainstDino(missile, fromX, dinoAt(dinos, index));
+                if (hitX >= 0 && (target < 0 || abs(hitX - fromX) < abs(targetX - fromX)))
+                {
+                    target = index;
+                    targetX = hitX;
+                }
+            }
+        }
+
+        if (target >= 0)
+        {
+            missile.x = targetX;
+            missile.active = false;
+            Dino dino = dinoAt(dinos, target);
+            // Fora da cabeça o acerto é no corpo: o míssil só é destruído
+            if (checkCollisionWithDinoHead(missile, dino, m))
+            {
+                dinos.column<Health>()[target].headshotHits = dino.headshotHits;
+                if (!dino.alive)
+                {
+                    // A remoção troca o último para target; a grade acompanha
+                    int last = dinos.size() - 1;
+                    const std::vector<Position> &dinoPosition = dinos.column<Position>();
+                    grid.removeSwapped(target, dinoPosition[target], last, dinoPosition[last]);
+                    dinos.remove(target);
+                }
+            }
+        }
+
+        if (missile.x >= width || missile.x < 0)
+            missile.active = false;
+
+        if (missile.active)
+            i++;
+        else
+            missiles.remove(i); // A linha i recebe a última; reavaliar i
+    }
+}
+
+void World::after(Duration delay, TimerEvent event, int subject)
+{
+    int timer = timers.schedule(tick + ticksFor(delay), event, subject);
+    if (event == TimerEvent::ReloadDone)
+        helicopters.column<Pilot>()[subject].reloadTimer = timer;
+}
+
+void World::handleTimer(TimerEvent event, int subject)
+{
+    switch (event)
+    {
+    case TimerEvent::TruckDeparts:
+        // Caminhão traz mísseis de tempos em tempos
+        trucks.column<Delivery>()[subject].state = TruckState::Entering;
+        after(TRUCK_STEP, TimerEvent::TruckMoves, subject);
+        break;
+
+    case TimerEvent::TruckMoves:
+        moveTruck(subject);
+        break;
+
+    case TimerEvent::TruckUnloaded:
+        depot.trucksUnloading--;
+        message = "Depósito reabastecido pelo caminhão.";
+        truckMessage.clear();
+        trucks.column<Delivery>()[subject].state = TruckState::Leaving;
+        after(TRUCK_STEP, TimerEvent::TruckMoves, subject);
+        // Helicópteros podem estar esperando a descarga
+        for (int i = 0; i < (int)helicopters.size(); i++)
+            tryStartReload(i);
+        break;
+
+    case TimerEvent::ReloadDone:
+    {
+        Ammo &ammo = helicopters.column<Ammo>()[subject];
+        Pilot &pilot = helicopters.column<Pilot>()[subject];
+        pilot.reloadTimer = -1;
+        int crate;
+        while (ammo.missiles < ammo.capacity && depot.missiles.pop(crate))
+        {
+            ammo.missiles++;
+            depot.consumed++;
+        }
+
+        depot.helicoptersReloading--;
+        pilot.state = HelicopterState::Normal;
+        notify(subject, "Recarregamento concluído.");
+        // Agora há espaço e talvez o depósito esteja livre
+        for (int i = 0; i < (int)trucks.size(); i++)
+            tryUnloadTruck(i);
+        tryStartReload(subject); // Ainda falta míssil se o depósito tinha poucos
+        break;
+    }
+    }
+}
+
+void World::moveTruck(int index)
+{
+    Position &position = trucks.column<Position>()[index];
+    Delivery &delivery = trucks.column<Delivery>()[index];
+    position.x += trucks.column<Velocity>()[index].dx;
+    if (delivery.state == TruckState::Entering && position.x >= depot.x - 5)
+    {
+        truckMessage = "Caminhão chegou ao depósito. Tentando reabastecer...";
+        delivery.state = TruckState::AtDepot;
+        tryUnloadTruck(index);
+    }
+    else if (delivery.state == TruckState::Leaving && position.x >= width + TRUCK_WIDTH)
+    {
+        // Reiniciar posição do caminhão para próxima viagem
+        position.x = -TRUCK_WIDTH;
+        delivery.state = TruckState::Waiting;
+        after(TRUCK_TRIP_INTERVAL, TimerEvent::TruckDeparts, index);
+    }
+    else
+    {
+        after(TRUCK_STEP, TimerEvent::TruckMoves, index);
+    }
+}
+
+void World::tryUnloadTruck(int index)
+{
+    // Espera até que haja espaço no depósito e nenhum helicóptero esteja recarregando
+    Delivery &delivery = trucks.column<Delivery>()[index];
+    if (delivery.state != TruckState::AtDepot || depot.missiles.size() >= MAX_DEPOT_MISSILES ||
+        depot.helicoptersReloading > 0)
+        return;
+
+    while (depot.missiles.push(index))
+        depot.delivered++;
+    depot.trucksUnloading++;
+    delivery.state = TruckState::Unloading;
+    after(TRUCK_UNLOAD_TIME, TimerEvent::TruckUnloaded, index);
+}
+
+void World::tryStartReload(int index)
+{
+    // Só tenta recarregar no depósito e se faltar algum míssil
+    Helicopter helicopter = helicopterAt(helicopters, index);
+    if (helicopter.state != HelicopterState::Normal || helicopter.missiles >= helicopter.maxMissiles ||
+        !isHelicopterAtDepot(helicopter, depot))
+        return;
+
+    if (depot.missiles.size() > 0 && depot.trucksUnloading == 0)
+    {
+        depot.helicoptersReloading++;
+        helicopters.column<Pilot>()[index].state = HelicopterState::Reloading;
+        after(HELICOPTER_RELOAD_TIME, TimerEvent::ReloadDone, index);
+        notify(index, "Recarregando...");
+    }
+    else
+    {
+        notify(index, "Aguardando para recarregar...");
+    }
+}
+
+void World::helicopterMoved(int index)
+{
+    // Se o helicóptero sair do depósito durante o recarregamento
+    Pilot &pilot = helicopters.column<Pilot>()[index];
+    if (pilot.state == HelicopterState::Reloading && !isHelicopterAtDepot(helicopterAt(helicopters, index), depot))
+    {
+        timers.cancel(pilot.reloadTimer);
+        pilot.reloadTimer = -1;
+        depot.helicoptersReloading--;
+        pilot.state = HelicopterState::Normal;
+        notify(index, "Recarregamento cancelado.");
+        for (int i = 0; i < (int)trucks.size(); i++)
+            tryUnloadTruck(i);
+        return;
+    }
+    tryStartReload(index);
+}
+
+void WorldSnapshot::reserve()
+{
+    dinos.reserve(maxAliveDinos);
+    missiles.reserve(maxMissiles);
+    helicopters.reserve(MAX_HELICOPTERS);
+    trucks.reserve(MAX_TRUCKS);
+    message.reserve(MAX_MESSAGE);
+    truckMessage.reserve(MAX_MESSAGE);
+}
+
+void World::snapshot(WorldSnapshot &snap) const
+{
+    // Reaproveita a memória dos vetores do quadro recebido
+    snap.dinos = dinos;
+    snap.missiles = missiles;
+    snap.helicopters = helicopters;
+    snap.trucks = trucks;
+    snap.depot = depot;
+    snap.message = message;
+    snap.truckMessage = truckMessage;
+    snap.gameOver = gameOver;
+    snap.showStats = showStats;
+    if (showStats)
+    {
+        snap.tickTimes = tickTimes.summary();
+        snap.dinoTimes = dinoTimes.summary();
+        snap.missileTimes = missileTimes.summary();
+    }
+}
+
+void applyDifficulty(int choice, int &m, int &n, int &t)
+{
+    switch (choice)
+    {
+    case '1':
+        m = 1;
+        n = 20;
+        t = 10;
+        break;
+    case '2':
+        m = 2;
+        n = 15;
+        t = 7;
+        break;
+    case '3':
+        m = 3;
+        n = 10;
+        t = 5;
+        break;
+    }
+}
+
+// **Threads**
+
+// Só marca; a thread de desenho consulta o novo tamanho entre quadros
+volatile sig_atomic_t terminalResized = 0;
+
+void onTerminalResize(int)
+{
+    terminalResized = 1;
+}
+
+// Tudo o que as partidas interativas usam. Fica montado pelo programa
+// inteiro: cada rodada só reinicia o mundo no lugar, e as threads de
+// entrada e simulação esperam a próxima rodada em vez de serem recriadas.
+struct SessionManager
+{
+    World world;
+    TickScheduler scheduler;
+    Renderer renderer;
+    SnapshotExchange exchange;
+    InputQueue input;
+    CancellationToken quit;  // Fim do programa: para a thread de entrada
+    CancellationToken round; // Fim da rodada: para simulação e desenho
+    Recorder recorder;
+    bool recording = false;
+    float shutdownMicros = 0; // Do cancelamento da rodada até a simulação parar
+    int rounds = 0;
+    bool saved = false; // --save: o jogo foi salvo ao sair
+    std::string loadError; // Por que o jogo salvo não foi carregado; o menu mostra
+
+    SessionManager(const Options &options, JobSystem &jobs, WINDOW *inputWindow);
+    ~SessionManager() { shutdown(); }
+
+    // Para e junta as threads; pode ser chamada mais de uma vez
+    void shutdown();
+
+    // Joga uma rodada até a simulação cancelá-la ('q' ou fim de jogo).
+    // Com resumePath a rodada continua um jogo salvo em vez de começar do
+    // zero. Retorna a tecla da tela de GAME OVER, ou 'q' se o jogador saiu.
+    // Se o jogo salvo não carregar, não joga: retorna ERR com o motivo em
+    // loadError.
+    int playRound(int m, int n, int t, const char *resumePath = nullptr);
+    // Próxima tecla da fila; só enquanto nenhuma rodada está rodando
+    int waitKey();
+
+private:
+    void simulationMain();
+
+    const Options &options;
+    uint64_t seed;
+    WorldSnapshot snap;
+    std::mutex mutex;
+    std::condition_variable changed;
+    int started = 0;  // Rodadas iniciadas pelo desenho
+    int finished = 0; // Rodadas que a simulação terminou
+    bool closing = false;
+    std::thread inputThread;
+    std::thread simulationThread;
+};
+
+SessionManager::SessionManager(const Options &options, JobSystem &jobs, WINDOW *inputWindow)
+    : world(1, 10, 5, options.seed), scheduler(jobs, world), options(options), seed(options.seed)
+{
+    world.scheduler = &scheduler;
+    world.profiling = true;
+    world.missileSpeed = options.missileSpeed;
+    renderer.watchedLock = &exchange.mutex;
+    renderer.pacer.setTarget(options.fps);
+
+    inputThread = std::thread(inputLoop, inputWindow, std::ref(input), std::cref(quit));
+    simulationThread = std::thread(&SessionManager::simulationMain, this);
+}
+
+void SessionManager::shutdown()
+{
+    if (!simulationThread.joinable())
+        return;
+    quit.cancel();
+    round.cancel();
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        closing = true;
+    }
+    changed.notify_all();
+    simulationThread.join();
+    inputThread.join();
+}
+
+void SessionManager::simulationMain()
+{
+    ThreadScope scope("simulação");
+    while (true)
+    {
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            changed.wait(lock, [this] { return closing || started > finished; });
+            if (closing)
+                return;
+        }
+        simulationLoop(world, input, exchange, recording ? &recorder : nullptr, round);
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            finished++;
+        }
+        changed.notify_all();
+    }
+}
+
+// Aplica um redimensionamento pendente do terminal; retorna se houve
+bool syncTerminalSize(Renderer &renderer)
+{
+    if (!terminalResized)
+        return false;
+    terminalResized = 0;
+    struct winsize size;
+    if (ioctl(STDOUT_FILENO, TIOCGWINSZ, &size) == 0)
+        resizeterm(size.ws_row, size.ws_col);
+    erase();
+    renderer.resize(COLS, LINES);
+    return true;
+}
+
+int SessionManager::waitKey()
+{
+    int ch;
+    while (!input.pop(ch))
+    {
+        if (!quit.sleepUntil(Clock::now() + TICK))
+            return 'q';
+    }
+    return ch;
+}
+
+int SessionManager::playRound(int m, int n, int t, const char *resumePath)
+{
+    syncTerminalSize(renderer);
+    applyFieldOptions(options, COLS, LINES);
+
+    // A simulação está parada esperando a rodada, então o mundo é só desta thread
+    std::string greeting = world.message;
+    bool resumed = resumePath != nullptr;
+    if (resumed)
+    {
+        std::string error;
+        if (!loadWorld(resumePath, world, error))
+        {
+            // A leitura pode ter trocado o campo; o menu escolhe a dificuldade
+            applyFieldOptions(options, COLS, LINES);
+            loadError = "Jogo salvo não carregado: " + error;
+            loadError.resize(std::min<size_t>(loadError.size(), MAX_MESSAGE));
+            return ERR;
+        }
+        world.message = "Jogo salvo carregado.";
+    }
+    else
+    {
+        world.reset(m, n, t, seed);
+        world.missileSpeed = options.missileSpeed;
+        world.endless = false;
+        world.message = greeting;
+    }
+    round.reset();
+    // A gravação parte de um mundo novo; uma rodada retomada não é gravada
+    recording = options.recordPath && !resumed &&
+                recorder.open(options.recordPath, seed, m, n, t, options.missileSpeed);
+    renderer.resize(COLS, LINES);
+    snap.reserve();
+    exchange.latest.reserve();
+    world.snapshot(snap);
+    rounds++;
+
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        started++;
+    }
+    changed.notify_all();
+
+    FramePacer &pacer = renderer.pacer;
+    pacer.start();
+    while (!round.cancelled())
+    {
+        int merged = exchange.take(snap);
+        bool resized = syncTerminalSize(renderer);
+
+        // Sem tick novo nem mudança no terminal, a tela já está certa
+        if (merged || resized || renderer.fullRedraw)
+        {
+            pacer.coalesced += std::max(merged - 1, 0);
+            auto frameStart = Clock::now();
+            renderer.compose(snap);
+            renderer.present();
+            renderer.frameTimes.add(elapsedMicros(frameStart));
+            pacer.framePresented(Clock::now());
+        }
+        else
+            pacer.idle++;
+
+        round.sleepUntil(pacer.advance());
+    }
+    pacer.stop();
+    {
+        std::unique_lock<std::mutex> lock(mutex);
+        changed.wait(lock, [this] { return finished == started; });
+    }
+    shutdownMicros = elapsedMicros(round.cancelledAt);
+    seed = world.rng.next();
+
+    // Último quadro publicado (a tela de GAME OVER)
+    exchange.take(snap);
+    renderer.compose(snap);
+    renderer.present();
+
+    if (!world.running)
+    {
+        // Saída no meio da rodada: a simulação já parou, o mundo está inteiro
+        if (options.savePath)
+            saved = saveWorld(options.savePath, world);
+        return 'q';
+    }
+
+    // Teclas apertadas durante a rodada não contam como resposta
+    int ch;
+    while (input.pop(ch))
+        ;
+    return waitKey();
+}
+
+// Retorna false se o jogador preferiu sair ('q')
+bool showDifficultyMenu(SessionManager &session, int &m, int &n, int &t)
+{
+    clear();
+    mvprintw(0, 0, "Escolha o grau de dificuldade:");
+
+    mvprintw(2, 0, "1. Fácil   (m=1, n=20, t=10)");
+    mvprintw(3, 0, "2. Médio   (m=2, n=15, t=7)");
+    mvprintw(4, 0, "3. Difícil (m=3, n=10, t=5)");
+    mvprintw(6, 0, "Escolha (1/2/3): ");
+    if (!session.loadError.empty())
+        mvprintw(8, 0, "%s", session.loadError.c_str());
+    refresh();
+
+    // A thread de entrada é a única que lê o teclado
+    int choice = 0;
+    while (choice < '1' || choice > '3')
+    {
+        choice = session.waitKey();
+        if (choice == 'q')
+            return false;
+    }
+
+    applyDifficulty(choice, m, n, t);
+
+    // Em vez de uma pausa antes da partida, a escolha aparece na primeira
+    // mensagem; a falha do jogo salvo continua no HUD no lugar dela
+    clear();
+    if (!session.loadError.empty())
+        session.world.message = session.loadError;
+    else
+        session.world.message = std::string("Dificuldade selecionada: ") +
+                                (choice == '1' ? "Fácil" : (choice == '2' ? "Médio" : "Difícil"));
+    session.loadError.clear();
+    return true;
+}
+
+CancellationToken::CancellationToken()
+{
+    if (pipe(wakePipe) != 0)
+    {
+        perror("pipe");
+        abort();
+    }
+}
+
+CancellationToken::~CancellationToken()
+{
+    close(wakePipe[0]);
+    close(wakePipe[1]);
+}
+
+void CancellationToken::cancel()
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (stopped.load(std::memory_order_relaxed))
+            return;
+        cancelledAt = Clock::now();
+        stopped.store(true, std::memory_order_release);
+    }
+    wake.notify_all();
+    char byte = 0;
+    if (write(wakePipe[1], &byte, 1) != 1)
+        perror("write");
+}
+
+void CancellationToken::reset()
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    if (!stopped.load(std::memory_order_relaxed))
+        return;
+    // cancel() escreveu um único byte no pipe
+    char byte;
+    if (read(wakePipe[0], &byte, 1) != 1)
+        perror("read");
+    stopped.store(false, std::memory_order_release);
+}
+
+bool CancellationToken::sleepUntil(Clock::time_point deadline)
+{
+    std::unique_lock<std::mutex> lock(mutex);
+    return !wake.wait_until(lock, deadline, [this] { return stopped.load(std::memory_order_relaxed); });
+}
+
+void SnapshotExchange::publish(WorldSnapshot &snap)
+{
+    std::lock_guard<ProfiledMutex> lock(mutex);
+    std::swap(latest, snap);
+    pending++;
+}
+
+int SnapshotExchange::take(WorldSnapshot &snap)
+{
+    std::lock_guard<ProfiledMutex> lock(mutex);
+    int merged = pending;
+    if (merged)
+        std::swap(latest, snap);
+    pending = 0;
+    return merged;
+}
+
+void simulationLoop(World &world, InputQueue &queue, SnapshotExchange &exchange, Recorder *recorder,
+                    CancellationToken &stop)
+{
+    WorldSnapshot snap;
+    snap.reserve();
+    auto nextTick = Clock::now();
+
+    while (world.running && !world.gameOver && !stop.cancelled())
+    {
+        // Atraso grande demais (máquina carregada): descarta em vez de acelerar
+        if (Clock::now() - nextTick > MAX_FRAME_LAG)
+            nextTick = Clock::now();
+
+        auto tickStart = Clock::now();
+
+        // Teclas da fila são aplicadas uma vez por tick
+        int ch;
+        while (queue.pop(ch))
+        {
+            if (recorder)
+                recorder->key(world.tick, ch);
+            world.handleKey(ch);
+        }
+
+        world.step(TICK);
+        world.snapshot(snap);
+        exchange.publish(snap);
+
+        world.tickTimes.add(elapsedMicros(tickStart));
+
+        nextTick += TICK;
+        if (!stop.sleepUntil(nextTick))
+            break;
+    }
+
+    if (recorder)
+        recorder->close(world.tick);
+    // Fim da partida encerra a rodada
+    stop.cancel();
+}
+
+
+void inputLoop(WINDOW *window, InputQueue &queue, const CancellationToken &stop)
+{
+    ThreadScope scope("entrada");
+    struct pollfd fds[2] = {{STDIN_FILENO, POLLIN, 0}, {stop.fd(), POLLIN, 0}};
+    while (!stop.cancelled())
+    {
+        // Espera por teclas ou pelo cancelamento, sem trava e sem timeout
+        if (poll(fds, 2, -1) <= 0 || stop.cancelled())
+            continue;
+
+        int ch;
+        while ((ch = wgetch(window)) != ERR)
+        {
+            if (ch != KEY_RESIZE) // Redimensionamento é tratado no desenho
+                queue.push(ch);   // Com a fila cheia a tecla é descartada
+        }
+    }
+}
+
+// Grava as medições da sessão em JSON
+void writeStats(const char *path, const World &world, const Renderer &renderer, const ProfiledMutex &lock)
+{
+    FILE *file = fopen(path, "w");
+    if (!file)
+    {
+        perror(path);
+        return;
+    }
+
+    auto latency = [file](const char *name, const LatencySummary &stats, bool last)
+    {
+        fprintf(file, "    \"%s\": {\"count\": %ld, \"mean_us\": %.2f, \"p50_us\": %.2f, \"p99_us\": %.2f, \"max_us\": %.2f}%s\n",
+                name, stats.count, stats.mean, stats.p50, stats.p99, stats.max, last ? "" : ",");
+    };
+
+    fprintf(file, "{\n  \"latency\": {\n");
+    latency("tick", world.tickTimes.summary(), false);
+    latency("dino_step", world.dinoTimes.summary(), false);
+    latency("missile_step", world.missileTimes.summary(), false);
+    latency("frame", renderer.frameTimes.summary(), true);
+    fprintf(file, "  },\n  \"threads_alive\": %d,\n", threads.alive.load());
+    const FramePacer &pacer = renderer.pacer;
+    fprintf(file, "  \"frames\": {\"target_fps\": %d, \"average_fps\": %.2f, \"presented\": %ld, \"idle\": %ld, "
+                  "\"dropped\": %ld, \"coalesced_ticks\": %ld},\n",
+            pacer.targetFps, pacer.averageFps(), pacer.presented, pacer.idle, pacer.dropped, pacer.coalesced);
+    double simulated = world.tick * std::chrono::duration<double>(TICK).count();
+    fprintf(file, "  \"depot\": {\"trucks\": %d, \"helicopters\": %d, \"delivered\": %ld, \"consumed\": %ld, "
+                  "\"delivered_per_s\": %.3f, \"consumed_per_s\": %.3f},\n",
+            truckCount, helicopterCount, world.depot.delivered, world.depot.consumed,
+            simulated > 0 ? world.depot.delivered / simulated : 0.0, simulated > 0 ? world.depot.consumed / simulated : 0.0);
+
+    fprintf(file, "  \"snapshot_lock\": [\n");
+    int registered = std::min(threads.registered.load(), MAX_THREADS);
+    for (int i = 0; i < registered; i++)
+    {
+        const LockCounters &counters = lock.perThread[i];
+        fprintf(file, "    {\"thread\": \"%s\", \"acquisitions\": %lu, \"contended\": %lu, \"wait_us\": %.1f, \"hold_us\": %.1f}%s\n",
+                threads.names[i], counters.acquisitions.load(), counters.contended.load(),
+                counters.waitNanos.load() / 1000.0, counters.holdNanos.load() / 1000.0,
+                i + 1 < registered ? "," : "");
+    }
+    fprintf(file, "  ]\n}\n");
+    fclose(file);
+}
+
+// **Gravação e Replay**
+
+bool Recorder::open(const char *path, uint64_t seed, int m, int n, int t, int missileSpeed)
+{
+    file = fopen(path, "w");
+    if (!file)
+    {
+        perror(path);
+        return false;
+    }
+    fprintf(file, "DINOREC 4\nseed %llu\ndifficulty %d %d %d\nmissile-speed %d\nfield %d %d\nlimits %d %d\nfleet %d %d\n",
+            (unsigned long long)seed, m, n, t, missileSpeed, width, height, maxAliveDinos, maxMissiles,
+            truckCount, helicopterCount);
+    return true;
+}
+
+void Recorder::key(long tick, int key)
+{
+    fprintf(file, "key %ld %d\n", tick, key);
+}
+
+void Recorder::close(long tick)
+{
+    fprintf(file, "end %ld\n", tick);
+    fclose(file);
+    file = nullptr;
+}
+
+bool loadRecording(const char *path, Recording &recording)
+{
+    FILE *file = fopen(path, "r");
+    if (!file)
+    {
+        perror(path);
+        return false;
+    }
+
+    int version = 0;
+    unsigned long long seed = 0;
+    bool ok = fscanf(file, "DINOREC %d seed %llu difficulty %d %d %d", &version, &seed,
+                     &recording.m, &recording.n, &recording.t) == 5 &&
+              version >= 1 && version <= 4;
+    recording.seed = seed;
+
+    // Linhas que faltam nas versões antigas ficam com o padrão da época
+    char tag[16];
+    while (ok && fscanf(file, "%15s", tag) == 1)
+    {
+        KeyEvent event;
+        if (strcmp(tag, "key") == 0 && fscanf(file, "%ld %d", &event.tick, &event.key) == 2)
+            recording.events.push_back(event);
+        else if (strcmp(tag, "missile-speed") == 0 && fscanf(file, "%d", &recording.missileSpeed) == 1)
+            ok = recording.missileSpeed > 0;
+        else if (strcmp(tag, "field") == 0 && fscanf(file, "%d %d", &recording.width, &recording.height) == 2)
+            ok = recording.width >= MIN_WIDTH && recording.height >= MIN_HEIGHT;
+        else if (strcmp(tag, "limits") == 0 && fscanf(file, "%d %d", &recording.maxDinos, &recording.maxMissiles) == 2)
+            ok = recording.maxDinos > 0 && recording.maxMissiles > 0;
+        else if (strcmp(tag, "fleet") == 0 && fscanf(file, "%d %d", &recording.trucks, &recording.helicopters) == 2)
+            ok = recording.trucks > 0 && recording.trucks <= MAX_TRUCKS && recording.helicopters > 0 &&
+                 recording.helicopters <= MAX_HELICOPTERS;
+        else if (strcmp(tag, "end") == 0 && fscanf(file, "%ld", &recording.endTick) == 1)
+            break;
+        else
+            ok = false;
+    }
+    fclose(file);
+
+    if (!ok || recording.endTick < 0)
+    {
+        fprintf(stderr, "%s: gravação inválida ou incompleta\n", path);
+        return false;
+    }
+    return true;
+}
+
+// FNV-1a sobre o estado da simulação, para comparar dois replays
+uint64_t worldChecksum(const World &world)
+{
+    uint64_t hash = 0xcbf29ce484222325ull;
+    auto mix = [&hash](long value)
+    {
+        hash ^= (uint64_t)value;
+        hash *= 0x100000001b3ull;
+    };
+
+    mix(world.tick);
+    mix(world.gameOver);
+    for (int i = 0; i < world.dinos.size(); i++)
+    {
+        Dino dino = dinoAt(world.dinos, i);
+        mix(dino.x);
+        mix(dino.y);
+        mix(dino.movingRight ? 1 : -1);
+        mix(dino.headshotHits);
+    }
+    for (const Position &missile : world.missiles.column<Position>())
+    {
+        mix(missile.x);
+        mix(missile.y);
+    }
+    for (int i = 0; i < world.helicopters.size(); i++)
+    {
+        Helicopter helicopter = helicopterAt(world.helicopters, i);
+        mix(helicopter.x);
+        mix(helicopter.y);
+        mix(helicopter.missiles);
+    }
+    mix(world.depot.missiles.size());
+    for (int i = 0; i < world.trucks.size(); i++)
+    {
+        mix(world.trucks.column<Position>()[i].x);
+        mix((long)world.trucks.column<Delivery>()[i].state);
+    }
+    return hash;
+}
+
+// Reproduz uma gravação o mais rápido possível e mede o tempo gasto
+int runReplay(const Options &options)
+{
+    Recording recording;
+    if (!loadRecording(options.replayPath, recording))
+        return 1;
+
+    width = recording.width;
+    height = recording.height;
+    maxAliveDinos = recording.maxDinos;
+    maxMissiles = recording.maxMissiles;
+    truckCount = recording.trucks;
+    helicopterCount = recording.helicopters;
+    World world(recording.m, recording.n, recording.t, recording.seed);
+    world.missileSpeed = recording.missileSpeed;
+    std::unique_ptr<JobSystem> jobs;
+    std::unique_ptr<TickScheduler> scheduler;
+    attachScheduler(world, options.workers, jobs, scheduler);
+
+    size_t next = 0;
+    auto start = Clock::now();
+    while (world.tick < recording.endTick && world.running && !world.gameOver)
+    {
+        while (next < recording.events.size() && recording.events[next].tick == world.tick)
+            world.handleKey(recording.events[next++].key);
+        world.step(TICK);
+    }
+    auto elapsed = std::chrono::duration<double>(Clock::now() - start).count();
+
+    // Teclas aplicadas no último tick (por exemplo o 'q' que encerrou a partida)
+    while (next < recording.events.size())
+        world.handleKey(recording.events[next++].key);
+
+    printf("ticks:            %ld\n", world.tick);
+    printf("teclas:           %zu\n", recording.events.size());
+    printf("tempo:            %.3f s\n", elapsed);
+    printf("ticks/s:          %.0f\n", world.tick / elapsed);
+    printf("estado final:     %016llx\n", (unsigned long long)worldChecksum(world));
+    return 0;
+}
+
+// **Jogo Salvo**
+
+bool SaveReader::read(void *out, size_t bytes)
+{
+    if (!ok || bytes > size - offset)
+        return ok = false;
+    memcpy(out, data + offset, bytes);
+    offset += bytes;
+    return true;
+}
+
+template <typename Table>
+void writeTable(FILE *file, const Table &table)
+{
+    int32_t rows = table.size();
+    fwrite(&rows, sizeof(rows), 1, file);
+    table.forEachColumn([file](const auto &column)
+                        {
+                            using Component = typename std::decay_t<decltype(column)>::value_type;
+                            static_assert(std::is_trivially_copyable<Component>::value, "Componente salvo byte a byte");
+                            fwrite(column.data(), sizeof(Component), column.size(), file);
+                        });
+}
+
+template <typename Table>
+bool readTable(SaveReader &reader, Table &table, int maxRows)
+{
+    int32_t rows = 0;
+    if (!reader.read(&rows, sizeof(rows)) || rows < 0 || rows > maxRows)
+        return false;
+    // Dentro da capacidade reservada pelo reset: nada é realocado
+    table.forEachColumn([&reader, rows](auto &column)
+                        {
+                            using Component = typename std::decay_t<decltype(column)>::value_type;
+                            column.resize(rows);
+                            reader.read(column.data(), rows * sizeof(Component));
+                        });
+    return reader.ok;
+}
+
+template <typename Table>
+bool spritesAre(const Table &table, SpriteId id)
+{
+    const std::vector<SpriteId> &sprite = table.template column<SpriteId>();
+    return std::all_of(sprite.begin(), sprite.end(), [id](SpriteId s) { return s == id; });
+}
+
+// Tudo o que o jogo usa como índice ou contador precisa bater com o resto
+// do estado; um arquivo corrompido não pode levar a acesso fora dos limites
+bool savedWorldValid(const World &world)
+{
+    if (!spritesAre(world.dinos, SpriteId::Dino) || !spritesAre(world.missiles, SpriteId::Missile) ||
+        !spritesAre(world.helicopters, SpriteId::Helicopter) || !spritesAre(world.trucks, SpriteId::Truck))
+        return false;
+    if (!world.timers.valid(world.tick))
+        return false;
+
+    // Eventos pendentes apontam para veículos que existem
+    for (int slot = 0; slot < TIMER_SLOTS; slot++)
+        for (int timer = world.timers.slots[slot]; timer >= 0; timer = world.timers.timers[timer].next)
+        {
+            const TimerWheel::Timer &node = world.timers.timers[timer];
+            int vehicles = node.event == TimerEvent::ReloadDone ? world.helicopters.size() : world.trucks.size();
+            if (node.subject < 0 || node.subject >= vehicles)
+                return false;
+        }
+
+    // Quem recarrega tem exatamente o seu ReloadDone agendado
+    int reloading = 0;
+    for (int i = 0; i < world.helicopters.size(); i++)
+    {
+        const Pilot &pilot = world.helicopters.column<Pilot>()[i];
+        const Ammo &ammo = world.helicopters.column<Ammo>()[i];
+        if (ammo.capacity != world.n || ammo.missiles < 0 || ammo.missiles > ammo.capacity)
+            return false;
+        if (pilot.state == HelicopterState::Normal)
+        {
+            if (pilot.reloadTimer != -1)
+                return false;
+            continue;
+        }
+        if (pilot.state != HelicopterState::Reloading || pilot.reloadTimer < 0 || pilot.reloadTimer >= MAX_TIMERS)
+            return false;
+        const TimerWheel::Timer &node = world.timers.timers[pilot.reloadTimer];
+        if (node.event != TimerEvent::ReloadDone || node.subject != i || !world.timers.scheduled(pilot.reloadTimer))
+            return false;
+        reloading++;
+    }
+
+    int unloading = 0;
+    for (const Delivery &delivery : world.trucks.column<Delivery>())
+    {
+        if (delivery.state < TruckState::Waiting || delivery.state > TruckState::Leaving)
+            return false;
+        unloading += delivery.state == TruckState::Unloading;
+    }
+
+    // Os contadores do depósito são recontados a partir dos veículos
+    const Depot &depot = world.depot;
+    return depot.helicoptersReloading == reloading && depot.trucksUnloading == unloading && depot.delivered >= 0 &&
+           depot.consumed >= 0;
+}
+
+bool saveWorld(const char *path, const World &world)
+{
+    FILE *file = fopen(path, "wb");
+    if (!file)
+    {
+        perror(path);
+        return false;
+    }
+
+    SaveHeader header{};
+    memcpy(header.magic, SAVE_MAGIC, sizeof(header.magic));
+    header.version = SAVE_VERSION;
+    header.width = width;
+    header.height = height;
+    header.maxDinos = maxAliveDinos;
+    header.maxMissiles = maxMissiles;
+    header.trucks = truckCount;
+    header.helicopters = helicopterCount;
+    header.m = world.m;
+    header.n = world.n;
+    header.t = world.t;
+    header.missileSpeed = world.missileSpeed;
+    header.gameOver = world.gameOver;
+    header.endless = world.endless;
+    header.tick = world.tick;
+    header.rngState = world.rng.state;
+    header.spawnMillis = world.spawnTimer.count();
+    header.dinoMillis = world.dinoTimer.count();
+    header.missileMillis = world.missileTimer.count();
+    fwrite(&header, sizeof(header), 1, file);
 
-// **Protótipos das Funções**
-void drawSkyAndGrass(int width, int height);
-void drawDino(const Dino &dino);
-void eraseDino(const Dino &dino);
-void drawHelicopter(int x, int y, bool movingRight);
-void eraseHelicopter(int x, int y);
-void drawMissile(Missile &missile);
-void eraseMissile(Missile &missile);
-void drawTruck(int x, int y, bool movingRight);
-void eraseTruck(int x, int y);
-void drawDeposit(int x, int y);
-bool isHelicopterAtDepot();
-void unloadMissilesToDepot(int amount);
-void truckAnimation();
-bool checkCollisionWithDinoHead(const Missile &missile, Dino &dino);
-bool checkCollisionWithDinoBody(const Missile &missile, const Dino &dino);
-bool checkCollisionWithHelicopter(const Dino &dino);
-void missileThread(Missile missile);
-int countAliveDinos();
-void dinoAnimation();
-void spawnDino();
-void showDifficultyMenu(int &m, int &n, int &t);
+    // A cópia da fila só vale com o depósito parado, como aqui
+    MpmcQueue<int, MAX_DEPOT_MISSILES> crates = world.depot.missiles;
+    SaveDepot depot{};
+    depot.x = world.depot.x;
+    depot.y = world.depot.y;
+    depot.trucksUnloading = world.depot.trucksUnloading;
+    depot.helicoptersReloading = world.depot.helicoptersReloading;
+    depot.delivered = world.depot.delivered;
+    depot.consumed = world.depot.consumed;
+    depot.crates = crates.size();
+    fwrite(&depot, sizeof(depot), 1, file);
+    int crate;
+    while (crates.pop(crate))
+    {
+        int32_t truck = crate;
+        fwrite(&truck, sizeof(truck), 1, file);
+    }
 
-// **Implementações das Funções**
+    static_assert(std::is_trivially_copyable<TimerWheel>::value, "Roda de eventos salva byte a byte");
+    fwrite(&world.timers, sizeof(world.timers), 1, file);
 
-void drawSkyAndGrass(int width, int height)
-{
-    for (int y = 0; y < height; y++)
+    for (const std::string *text : {&world.message, &world.truckMessage})
     {
-        attron(COLOR_PAIR(y < height / 3 ? 1 : 2)); // Céu ou grama
-        for (int x = 0; x < width; x++)
-        {
-            mvprintw(y, x, " ");
-        }
+        uint32_t length = text->size();
+        fwrite(&length, sizeof(length), 1, file);
+        fwrite(text->data(), 1, length, file);
     }
-    refresh();
+
+    writeTable(file, world.dinos);
+    writeTable(file, world.missiles);
+    writeTable(file, world.helicopters);
+    writeTable(file, world.trucks);
+
+    bool ok = !ferror(file);
+    ok = fclose(file) == 0 && ok;
+    if (!ok)
+        perror(path);
+    return ok;
 }
 
-void drawDino(const Dino &dino)
+// Troca o campo e os limites pelos do arquivo e reinicia o mundo com eles
+// antes de copiar o estado salvo
+bool readWorld(SaveReader &reader, World &world)
 {
-    const char **form = dino.movingRight ? dinoForm : dinoReversed;
-    for (int i = 0; i < 6; i++)
+    SaveHeader header;
+    if (!reader.read(&header, sizeof(header)) || memcmp(header.magic, SAVE_MAGIC, sizeof(header.magic)) != 0 ||
+        header.version != SAVE_VERSION)
+        return false;
+    // Mesmos limites da linha de comando: as reservas do reset precisam caber
+    if (header.width < MIN_WIDTH || header.width > MAX_FIELD_SIDE || header.height < MIN_HEIGHT ||
+        header.height > MAX_FIELD_SIDE || header.maxDinos <= 0 || header.maxDinos > MAX_ENTITIES ||
+        header.maxMissiles <= 0 || header.maxMissiles > MAX_ENTITIES ||
+        header.trucks <= 0 || header.trucks > MAX_TRUCKS || header.helicopters <= 0 ||
+        header.helicopters > MAX_HELICOPTERS || header.m <= 0 || header.n <= 0 || header.t <= 0 ||
+        header.missileSpeed <= 0 || header.missileSpeed > MAX_FIELD_SIDE || header.tick < 0)
+        return false;
+    // Os acumuladores sempre ficam abaixo de um período depois de cada tick
+    if (header.spawnMillis < 0 || header.spawnMillis >= Duration(std::chrono::seconds(header.t)).count() ||
+        header.dinoMillis < 0 || header.dinoMillis >= DINO_STEP.count() || header.missileMillis < 0 ||
+        header.missileMillis >= MISSILE_STEP.count())
+        return false;
+
+    width = header.width;
+    height = header.height;
+    maxAliveDinos = header.maxDinos;
+    maxMissiles = header.maxMissiles;
+    truckCount = header.trucks;
+    helicopterCount = header.helicopters;
+    world.reset(header.m, header.n, header.t, header.rngState);
+    world.missileSpeed = header.missileSpeed;
+    world.gameOver = header.gameOver != 0;
+    world.endless = header.endless != 0;
+    world.tick = header.tick;
+    world.spawnTimer = Duration(header.spawnMillis);
+    world.dinoTimer = Duration(header.dinoMillis);
+    world.missileTimer = Duration(header.missileMillis);
+
+    SaveDepot depot;
+    if (!reader.read(&depot, sizeof(depot)) || depot.crates < 0 || depot.crates > MAX_DEPOT_MISSILES)
+        return false;
+    world.depot.x = depot.x;
+    world.depot.y = depot.y;
+    world.depot.trucksUnloading = depot.trucksUnloading;
+    world.depot.helicoptersReloading = depot.helicoptersReloading;
+    world.depot.delivered = depot.delivered;
+    world.depot.consumed = depot.consumed;
+    int crate;
+    while (world.depot.missiles.pop(crate)) // Tira o estoque inicial do reset
+        ;
+    for (int i = 0; i < depot.crates; i++)
     {
-        mvaddstr(dino.y + i, dino.x, form[i]);
+        int32_t truck;
+        if (!reader.read(&truck, sizeof(truck)) || truck < -1 || truck >= truckCount)
+            return false;
+        world.depot.missiles.push(truck);
     }
-    refresh();
-}
 
-void eraseDino(const Dino &dino)
-{
-    for (int i = 0; i < 6; i++)
+    if (!reader.read(&world.timers, sizeof(world.timers)))
+        return false;
+
+    for (std::string *text : {&world.message, &world.truckMessage})
     {
-        mvaddstr(dino.y + i, dino.x, "                    ");
+        uint32_t length;
+        if (!reader.read(&length, sizeof(length)) || length > MAX_MESSAGE || length > reader.size - reader.offset)
+            return false;
+        text->assign(reader.data + reader.offset, length);
+        reader.offset += length;
     }
-    refresh();
+
+    return readTable(reader, world.dinos, maxAliveDinos) && readTable(reader, world.missiles, maxMissiles) &&
+           readTable(reader, world.helicopters, helicopterCount) && world.helicopters.size() == helicopterCount &&
+           readTable(reader, world.trucks, truckCount) && world.trucks.size() == truckCount &&
+           reader.offset == reader.size && savedWorldValid(world);
 }
 
-void drawHelicopter(int x, int y, bool movingRight)
+// Em caso de falha o motivo fica em error, sem escrever no terminal: no
+// modo interativo ele vai para o HUD, por cima do qual o stderr sairia
+bool loadWorld(const char *path, World &world, std::string &error)
 {
-    if (movingRight)
+    int fd = open(path, O_RDONLY);
+    if (fd < 0)
     {
-        mvprintw(y, x, "   __|__ ");
-        mvprintw(y + 1, x, "--@--@--o");
+        error = strerror(errno);
+        return false;
     }
-    else
+    struct stat info;
+    if (fstat(fd, &info) != 0 || info.st_size < (off_t)sizeof(SaveHeader))
+    {
+        close(fd);
+        error = "jogo salvo inválido";
+        return false;
+    }
+    void *map = mmap(nullptr, info.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (map == MAP_FAILED)
     {
-        mvprintw(y, x, " __|__   ");
-        mvprintw(y + 1, x, "o--@--@--");
+        error = strerror(errno);
+        return false;
     }
-    refresh();
-}
 
-void eraseHelicopter(int x, int y)
-{
-    mvprintw(y, x, "         ");
-    mvprintw(y + 1, x, "         ");
-    refresh();
+    SaveReader reader{(const char *)map, (size_t)info.st_size};
+    bool ok = readWorld(reader, world);
+    munmap(map, info.st_size);
+    if (!ok)
+        error = "jogo salvo inválido";
+    return ok;
 }
 
-void drawMissile(Missile &missile)
+// **Modo Headless**
+// Roda apenas a simulação, sem ncurses, o mais rápido possível, para medir
+// o custo da lógica separado do custo de escrever no terminal.
+
+int autopilotKey(const World &world, int index)
 {
-    if (missile.active && missile.x < width && missile.x >= 0)
+    Helicopter helicopter = helicopterAt(world.helicopters, index);
+
+    // Sem mísseis: voltar ao depósito e esperar o recarregamento
+    if (helicopter.missiles == 0 || helicopter.state == HelicopterState::Reloading)
     {
-        mvprintw(missile.y, missile.x, "-");
+        if (isHelicopterAtDepot(helicopter, world.depot))
+            return ERR;
+        if (helicopter.y < world.depot.y)
+            return KEY_DOWN;
+        if (helicopter.y > world.depot.y)
+            return KEY_UP;
+        return helicopter.x < world.depot.x ? KEY_RIGHT : KEY_LEFT;
     }
-    refresh();
+
+    // Alinhar com a cabeça de um dinossauro vivo (cada piloto escolhe um) e atirar
+    if (world.dinos.size() > 0)
+    {
+        Dino dino = dinoAt(world.dinos, index % world.dinos.size());
+        int headY = dino.y + 1;
+        if (helicopter.y < headY)
+            return KEY_DOWN;
+        if (helicopter.y > headY)
+            return KEY_UP;
+        bool dinoToTheRight = dino.x > helicopter.x;
+        if (dinoToTheRight != helicopter.movingRight)
+            return dinoToTheRight ? KEY_RIGHT : KEY_LEFT;
+        return ' ';
+    }
+    return ERR;
 }
 
-void eraseMissile(Missile &missile)
+// Com --workers os estágios do tick rodam no sistema de tarefas
+void attachScheduler(World &world, int workers, std::unique_ptr<JobSystem> &jobs,
+                     std::unique_ptr<TickScheduler> &scheduler)
 {
-    mvprintw(missile.y, missile.x, " ");
-    refresh();
+    if (workers < 0)
+        return;
+    jobs.reset(new JobSystem(workers));
+    scheduler.reset(new TickScheduler(*jobs, world));
+    world.scheduler = scheduler.get();
 }
 
-void drawTruck(int x, int y, bool movingRight)
+// Estresse: mantém o campo com maxAliveDinos - 1 dinossauros e o pool de
+// mísseis cheio, espalhados pela grama com o gerador do próprio mundo
+void fillForStress(World &world)
 {
-    const char **truckForm = movingRight ? truckRight : truckLeft;
-    for (int i = 0; i < 5; i++)
+    int ground = height / 3;
+    while (world.dinos.size() < maxAliveDinos - 1)
     {
-        if (x >= 0 && x < width)
-            mvaddstr(y + i, x, truckForm[i]);
+        int x = world.rng.below(width - 19);
+        int y = ground + world.rng.below(height - ground - DINO_HEIGHT + 1);
+        world.dinos.add({x, y}, {world.rng.below(2) ? 1 : -1}, SpriteId::Dino, {0});
+    }
+    while (world.missiles.size() < maxMissiles)
+    {
+        int x = world.rng.below(width);
+        int y = ground + world.rng.below(height - ground);
+        int speed = world.rng.below(2) == 1 ? world.missileSpeed : -world.missileSpeed;
+        world.missiles.add({x, y}, {speed}, SpriteId::Missile);
     }
-    refresh();
 }
 
-void eraseTruck(int x, int y)
+int runHeadless(const Options &options)
 {
-    for (int i = 0; i < 5; i++)
+    int m = 1, n = 10, t = 5;
+    applyDifficulty('0' + options.difficulty, m, n, t);
+    long ticks = options.ticks;
+
+    World world(m, n, t, options.seed);
+    world.missileSpeed = options.missileSpeed;
+    world.endless = options.stress;
+    std::unique_ptr<JobSystem> jobs;
+    std::unique_ptr<TickScheduler> scheduler;
+    attachScheduler(world, options.workers, jobs, scheduler);
+    if (options.loadPath)
     {
-        if (x >= 0 && x < width)
-            mvaddstr(y + i, x, std::string(30, ' ').c_str());
+        std::string error;
+        if (!loadWorld(options.loadPath, world, error))
+        {
+            fprintf(stderr, "%s: %s\n", options.loadPath, error.c_str());
+            return 1;
+        }
+        m = world.m;
+        n = world.n;
+        t = world.t;
     }
-    refresh();
-}
+    long rounds = 1;
+    long entityUpdates = 0;
+    long delivered = 0, consumed = 0; // Rodadas já encerradas
 
-void drawDeposit(int x, int y)
-{
-    mvprintw(y, x, "      _______");
-    mvprintw(y + 1, x, "     /       \\");
-    mvprintw(y + 2, x, "    /_________\\");
-    mvprintw(y + 3, x, "    |         |");
-    mvprintw(y + 4, x, "    |         |");
-    mvprintw(y + 5, x, "    |_________|");
-    refresh();
-}
+    long allocationsBefore = heapAllocations.load();
+    auto start = std::chrono::steady_clock::now();
+    for (long tick = 0; tick < ticks; tick++)
+    {
+        if (options.stress)
+            fillForStress(world);
+        int ch = autopilotKey(world, 0);
+        if (ch != ERR)
+            world.handleKey(ch);
 
-bool isHelicopterAtDepot()
-{
-    // Dimensões do helicóptero
-    int helicopterWidth = 9;
-    int helicopterHeight = 2;
+        world.step(TICK);
+        entityUpdates += world.dinos.size() + world.missiles.size() + world.helicopters.size() + world.trucks.size();
+
+        // Fim de rodada: começa outra para manter a carga
+        if (world.gameOver)
+        {
+            delivered += world.depot.delivered;
+            consumed += world.depot.consumed;
+            world.reset(m, n, t, world.rng.next());
+            rounds++;
+        }
+    }
+    auto elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    long loopAllocations = heapAllocations.load() - allocationsBefore;
 
-    // Dimensões do depósito
-    int depotWidth = 15;
-    int depotHeight = 6;
+    struct rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
 
-    // Verificar sobreposição
-    return (helicopterX + helicopterWidth >= depositX &&
-            helicopterX <= depositX + depotWidth &&
-            helicopterY + helicopterHeight >= depositY &&
-            helicopterY <= depositY + depotHeight);
+    printf("ticks:            %ld\n", ticks);
+    printf("campo:            %dx%d, até %d dinossauros e %d mísseis\n", width, height, maxAliveDinos, maxMissiles);
+    printf("rodadas:          %ld\n", rounds);
+    double simulated = ticks * std::chrono::duration<double>(TICK).count();
+    delivered += world.depot.delivered;
+    consumed += world.depot.consumed;
+    printf("frota:            %d caminhões, %d helicópteros\n", truckCount, helicopterCount);
+    printf("depósito:         %.3f entregues/s, %.3f consumidos/s (tempo simulado)\n",
+           delivered / simulated, consumed / simulated);
+    printf("tempo:            %.3f s\n", elapsed);
+    printf("ticks/s:          %.0f\n", ticks / elapsed);
+    printf("entidades/s:      %.0f\n", entityUpdates / elapsed);
+    printf("alocações no laço: %ld\n", loopAllocations);
+    printf("pico de RSS:      %ld KiB\n", usage.ru_maxrss);
+    printf("estado final:     %016llx\n", (unsigned long long)worldChecksum(world));
+    if (options.savePath && !saveWorld(options.savePath, world))
+        return 1;
+    if (options.checkAllocs && loopAllocations > 0)
+    {
+        fprintf(stderr, "O laço do jogo alocou %ld vezes; esperado nenhuma\n", loopAllocations);
+        return 1;
+    }
+    return 0;
 }
 
-void unloadMissilesToDepot(int amount)
+// Vazão da fila do depósito com produtores e consumidores em threads de
+// verdade, dobrando cada lado de 1 até --trucks e --helicopters
+int runDepotBench(const Options &options)
 {
-    std::unique_lock<std::mutex> lock(depotMutex);
-    // Espera até que haja espaço no depósito e o helicóptero não esteja recarregando
-    while ((depotMissiles >= MAX_DEPOT_MISSILES) || helicopterReloading)
+    const auto window = std::chrono::milliseconds(200);
+    printf("caminhões helicópteros  entregues/s  consumidos/s\n");
+    for (int producers = 1; producers <= options.trucks; producers *= 2)
     {
-        depotNotFull.wait(lock);
-    }
-    // Sinaliza que o caminhão está descarregando
-    truckUnloading = true;
+        for (int consumers = 1; consumers <= options.helicopters; consumers *= 2)
+        {
+            MpmcQueue<int, MAX_DEPOT_MISSILES> depot;
+            std::atomic<bool> running{true};
+            std::atomic<long> delivered{0}, consumed{0};
+            std::vector<std::thread> crew;
 
-    // Descarrega mísseis no depósito
-    int spaceAvailable = MAX_DEPOT_MISSILES - depotMissiles;
-    int missilesToUnload = std::min(amount, spaceAvailable);
-    depotMissiles += missilesToUnload;
+            for (int i = 0; i < producers; i++)
+                crew.emplace_back([&, i]
+                                  {
+                                      long count = 0;
+                                      while (running.load(std::memory_order_relaxed))
+                                      {
+                                          if (depot.push(i))
+                                              count++;
+                                          else
+                                              std::this_thread::yield(); // Cheio: dá a vez a quem consome
+                                      }
+                                      delivered += count;
+                                  });
+            for (int i = 0; i < consumers; i++)
+                crew.emplace_back([&]
+                                  {
+                                      long count = 0;
+                                      int crate;
+                                      while (running.load(std::memory_order_relaxed))
+                                      {
+                                          if (depot.pop(crate))
+                                              count++;
+                                          else
+                                              std::this_thread::yield(); // Vazio: dá a vez a quem produz
+                                      }
+                                      consumed += count;
+                                  });
 
-    // Simula tempo de descarregamento
-    lock.unlock();
-    std::this_thread::sleep_for(std::chrono::seconds(2));
-    lock.lock();
+            std::this_thread::sleep_for(window);
+            running = false;
+            for (auto &thread : crew)
+                thread.join();
 
-    // Termina o descarregamento
-    truckUnloading = false;
-    // Notifica que o depósito não está vazio (para o helicóptero)
-    depotNotEmpty.notify_all();
-    // Notifica que o depósito pode não estar cheio (para outros caminhões)
-    depotNotFull.notify_all();
+            double seconds = std::chrono::duration<double>(window).count();
+            printf("%9d %12d %12.0f %13.0f\n", producers, consumers, delivered / seconds, consumed / seconds);
+        }
+    }
+    return 0;
 }
 
-void truckAnimation()
+// Custo de um passo de movimento por tick, escalar contra vetorial, com
+// 1k, 10k e 100k linhas: quique (dinossauros) e só soma (mísseis)
+int runMoveBench()
 {
-    int truckWidth = 30; // Largura do caminhão
-    int truckX = -truckWidth;
-    int truckY = height - 10;
-    bool truckMovingRight = true;
-
-    while (running && !gameOver)
+    printf("kernel: %s, campo de %d colunas\n", movementKernel(), width);
+    printf("entidades   quique escalar  quique vetorial   soma escalar   soma vetorial   (us/tick)\n");
+    bool same = true;
+    for (int count : {1000, 10000, 100000})
     {
-        // Caminhão traz mísseis de tempos em tempos
-        std::this_thread::sleep_for(std::chrono::seconds(15)); // Tempo entre viagens do caminhão
-
-        // Caminhão entra na tela
-        while (truckX < depositX - 5 && running && !gameOver)
+        Random rng{(uint64_t)count};
+        std::vector<Position> start(count);
+        std::vector<Velocity> startVelocity(count);
+        for (int i = 0; i < count; i++)
         {
-            {
-                std::lock_guard<std::mutex> lock(mtx);
-                eraseTruck(truckX - 1, truckY);
-                truckX++;
-                if (truckX >= 0 && truckX < width)
-                    drawTruck(truckX, truckY, truckMovingRight);
-                drawDeposit(depositX, depositY);
-            }
-            std::this_thread::sleep_for(std::chrono::milliseconds(50));
+            start[i] = {rng.below(width - 19), rng.below(height)};
+            startVelocity[i] = {rng.below(2) ? 1 : -1};
         }
 
-        // Chegada ao depósito
+        // Cerca de 20 milhões de linhas por medida
+        int reps = std::max(20, 20000000 / count);
+        auto measure = [&](auto &&kernel, std::vector<Position> &position, std::vector<Velocity> &velocity)
         {
-            std::lock_guard<std::mutex> lock(mtx);
-            mvprintw(3, 0, "Caminhão chegou ao depósito. Tentando reabastecer...          ");
-        }
+            position = start;
+            velocity = startVelocity;
+            auto begin = Clock::now();
+            for (int r = 0; r < reps; r++)
+                kernel(position.data(), velocity.data(), count);
+            return elapsedMicros(begin) / reps;
+        };
 
-        unloadMissilesToDepot(MAX_DEPOT_MISSILES);
+        std::vector<Position> scalarPosition, vectorPosition;
+        std::vector<Velocity> scalarVelocity, vectorVelocity;
+        int maxX = width - 20;
+        float bounceScalar = measure([maxX](Position *p, Velocity *v, int n) { moveAndBounceScalar(p, v, 0, n, maxX); },
+                                     scalarPosition, scalarVelocity);
+        float bounceVector = measure([maxX](Position *p, Velocity *v, int n) { moveAndBounce(p, v, 0, n, maxX); },
+                                     vectorPosition, vectorVelocity);
+        for (int i = 0; i < count; i++)
+            same = same && scalarPosition[i].x == vectorPosition[i].x && scalarVelocity[i].dx == vectorVelocity[i].dx;
 
-        {
-            std::lock_guard<std::mutex> lock(mtx);
-            mvprintw(2, 0, "Depósito reabastecido pelo caminhão.                          ");
-            mvprintw(3, 0, "                                                              ");
-        }
+        float addScalar = measure([](Position *p, Velocity *v, int n) { moveEntitiesScalar(p, v, 0, n); },
+                                  scalarPosition, scalarVelocity);
+        float addVector = measure([](Position *p, Velocity *v, int n) { moveEntities(p, v, 0, n); },
+                                  vectorPosition, vectorVelocity);
+        for (int i = 0; i < count; i++)
+            same = same && scalarPosition[i].x == vectorPosition[i].x;
 
-        // Caminhão sai do depósito pela direita
-        while (truckX < width + truckWidth && running && !gameOver)
-        {
-            {
-                std::lock_guard<std::mutex> lock(mtx);
-                eraseTruck(truckX, truckY);
-                truckX++;
-                if (truckX >= 0 && truckX < width)
-                    drawTruck(truckX, truckY, truckMovingRight);
-                drawDeposit(depositX, depositY);
-            }
-            std::this_thread::sleep_for(std::chrono::milliseconds(50));
-        }
+        printf("%9d %16.2f %16.2f %14.2f %15.2f\n", count, bounceScalar, bounceVector, addScalar, addVector);
+    }
+    printf("resultados iguais: %s\n", same ? "sim" : "NÃO");
+    return same ? 0 : 1;
+}
 
-        // Limpar qualquer resíduo do caminhão que possa ficar na tela
-        {
-            std::lock_guard<std::mutex> lock(mtx);
-            eraseTruck(truckX - 1, truckY);
-        }
+// **Benchmarks**
+// Suíte das funções quentes em populações sintéticas, no formato JSON do
+// Google Benchmark para comparar builds (compare.py lê direto). Cada
+// benchmark repete o corpo até passar de --bench-min-time, aumentando as
+// iterações como a biblioteca faz, e informa o tempo por iteração.
+struct BenchResult
+{
+    std::string name;
+    long iterations;
+    double realNanos; // Por iteração
+    double cpuNanos;
+    double itemsPerSecond;
+};
 
-        // Reiniciar posição do caminhão para próxima viagem
-        truckX = -truckWidth;
-    }
+// Impede o compilador de descartar um resultado não usado
+template <typename T>
+inline void keepResult(const T &value)
+{
+    asm volatile("" : : "r,m"(value) : "memory");
 }
 
-bool checkCollisionWithDinoHead(const Missile &missile, Dino &dino)
+double threadCpuSeconds()
 {
-    if (!dino.alive)
-        return false;
+    struct timespec now;
+    clock_gettime(CLOCK_THREAD_CPUTIME_ID, &now);
+    return now.tv_sec + now.tv_nsec * 1e-9;
+}
 
-    // Coordenadas da cabeça do dinossauro
-    int headX = dino.x + (dino.movingRight ? 14 : 5);
-    int headY = dino.y + 1;
+struct BenchSuite
+{
+    const Options &options;
+    std::vector<BenchResult> results;
+
+    // items: elementos processados por iteração, para a vazão
+    template <typename Body>
+    void run(const std::string &name, long items, Body &&body);
+    bool writeJson(const char *path) const;
+};
+
+template <typename Body>
+void BenchSuite::run(const std::string &name, long items, Body &&body)
+{
+    if (options.benchFilter && name.find(options.benchFilter) == std::string::npos)
+        return;
 
-    // Verificar colisão com a cabeça
-    if (missile.x == headX && missile.y == headY)
+    long iterations = 1;
+    while (true)
     {
-        dino.headshotHits++;
-        if (dino.headshotHits >= m)
+        auto start = Clock::now();
+        double cpuStart = threadCpuSeconds();
+        for (long i = 0; i < iterations; i++)
+            body();
+        double real = std::chrono::duration<double>(Clock::now() - start).count();
+        double cpu = threadCpuSeconds() - cpuStart;
+
+        if (real >= options.benchMinTime || iterations >= 1000000000)
         {
-            dino.alive = false;
-            eraseDino(dino);
+            BenchResult result = {name, iterations, real * 1e9 / iterations, cpu * 1e9 / iterations,
+                                  real > 0 ? items * iterations / real : 0};
+            printf("%-36s %14.1f ns %14.1f ns %12ld\n", name.c_str(), result.realNanos, result.cpuNanos, iterations);
+            fflush(stdout);
+            results.push_back(result);
+            return;
         }
-        return true;
+        // Estimativa do que falta, com folga, sem crescer mais de 10x por vez
+        double multiplier = real > 0 ? options.benchMinTime * 1.4 / real : 10;
+        iterations = std::max(iterations + 1, (long)(iterations * std::min(multiplier, 10.0)));
     }
-    return false;
 }
 
-bool checkCollisionWithDinoBody(const Missile &missile, const Dino &dino)
+bool BenchSuite::writeJson(const char *path) const
 {
-    if (!dino.alive)
+    FILE *file = fopen(path, "w");
+    if (!file)
+    {
+        perror(path);
         return false;
+    }
 
-    // Dimensões do dinossauro
-    int dinoWidth = 20;
-    int dinoHeight = 6;
-
-    // Verificar colisão com o corpo
-    return (missile.x >= dino.x && missile.x < dino.x + dinoWidth &&
-            missile.y >= dino.y + 2 && missile.y < dino.y + dinoHeight);
+    char date[32];
+    time_t now = time(0);
+    strftime(date, sizeof(date), "%Y-%m-%dT%H:%M:%S", localtime(&now));
+    fprintf(file, "{\n  \"context\": {\n    \"date\": \"%s\",\n    \"executable\": \"dino_game\",\n"
+                  "    \"num_cpus\": %u,\n    \"movement_kernel\": \"%s\",\n    \"field\": \"%dx%d\",\n",
+            date, std::thread::hardware_concurrency(), movementKernel(), width, height);
+#ifdef NDEBUG
+    fprintf(file, "    \"library_build_type\": \"release\"\n  },\n");
+#else
+    fprintf(file, "    \"library_build_type\": \"debug\"\n  },\n");
+#endif
+    fprintf(file, "  \"benchmarks\": [\n");
+    for (size_t i = 0; i < results.size(); i++)
+    {
+        const BenchResult &result = results[i];
+        fprintf(file, "    {\"name\": \"%s\", \"run_name\": \"%s\", \"run_type\": \"iteration\", "
+                      "\"iterations\": %ld, \"real_time\": %.3f, \"cpu_time\": %.3f, \"time_unit\": \"ns\", "
+                      "\"items_per_second\": %.1f}%s\n",
+                result.name.c_str(), result.name.c_str(), result.iterations, result.realNanos, result.cpuNanos,
+                result.itemsPerSecond, i + 1 < results.size() ? "," : "");
+    }
+    fprintf(file, "  ]\n}\n");
+    return fclose(file) == 0;
 }
 
-bool checkCollisionWithHelicopter(const Dino &dino)
+void initColors()
 {
-    // Dimensões do helicóptero
-    int helicopterWidth = 9;
-    int helicopterHeight = 2;
-
-    // Verificar colisão entre o helicóptero e o dinossauro
-    return (helicopterX < dino.x + 20 && helicopterX + helicopterWidth > dino.x &&
-            helicopterY < dino.y + 6 && helicopterY + helicopterHeight > dino.y);
+    start_color();
+    init_pair(1, COLOR_BLUE, COLOR_BLUE);   // Céu
+    init_pair(2, COLOR_GREEN, COLOR_GREEN); // Grama
+    init_pair(PAIR_SKY_INK, COLOR_WHITE, COLOR_BLUE);
+    init_pair(PAIR_GRASS_INK, COLOR_BLACK, COLOR_GREEN);
 }
 
-void missileThread(Missile missile)
+int runBenchmarks(const Options &options)
 {
-    while (missile.active && running && !gameOver)
+    // Campo do estresse (ou o de --width/--height); os limites acompanham
+    // cada população
+    Options field = options;
+    field.stress = true;
+    applyFieldOptions(field, 100, 40);
+
+    // Tela falsa para o desenho: ncurses de verdade, escrevendo em /dev/null
+    FILE *screenOut = fopen("/dev/null", "w");
+    FILE *screenIn = fopen("/dev/null", "r");
+    SCREEN *screen = screenOut && screenIn ? newterm("xterm", screenOut, screenIn) : nullptr;
+    const int screenColumns = 110, screenRows = 45;
+    if (screen)
+    {
+        set_term(screen);
+        resizeterm(screenRows, screenColumns);
+        initColors();
+    }
+    else
+        fprintf(stderr, "Sem terminfo para a tela falsa; benchmarks de desenho não rodam\n");
+
+    printf("%-36s %17s %17s %12s\n", "benchmark", "tempo", "CPU", "iterações");
+    BenchSuite suite{options, {}};
+    for (int count : {1000, 10000, 100000})
     {
+        std::string suffix = "/" + std::to_string(count);
+        maxAliveDinos = count + 1;
+        maxMissiles = count;
+
+        // Mundo cheio como no estresse, com a semente fixa por população
+        World world(3, 10, 5, (uint64_t)count);
+        fillForStress(world);
+
+        // Um míssil e um helicóptero sobre a caixa de cada dinossauro, então
+        // parte dos testes acerta e parte erra
+        Random rng{(uint64_t)count};
+        std::vector<Dino> dinos(count);
+        std::vector<Missile> missiles(count);
+        std::vector<Helicopter> pilots(count);
+        for (int i = 0; i < count; i++)
         {
-            std::lock_guard<std::mutex> lock(mtx);
-            eraseMissile(missile);
+            dinos[i] = dinoAt(world.dinos, i);
+            missiles[i] = {dinos[i].x + rng.below(DINO_WIDTH), dinos[i].y + rng.below(DINO_HEIGHT), true,
+                           rng.below(2) == 1};
+            pilots[i] = helicopterAt(world.helicopters, 0);
+            pilots[i].x = dinos[i].x + rng.below(DINO_WIDTH + HELICOPTER_WIDTH) - HELICOPTER_WIDTH;
+            pilots[i].y = dinos[i].y + rng.below(DINO_HEIGHT + HELICOPTER_HEIGHT) - HELICOPTER_HEIGHT;
+        }
 
-            missile.x += missile.movingRight ? 1 : -1;
+        suite.run("checkCollisionWithDinoHead" + suffix, count, [&]
+                  {
+                      int hits = 0;
+                      for (int i = 0; i < count; i++)
+                      {
+                          Dino dino = dinos[i]; // A função conta o tiro no próprio dinossauro
+                          hits += checkCollisionWithDinoHead(missiles[i], dino, 3);
+                      }
+                      keepResult(hits);
+                  });
+        suite.run("checkCollisionWithDinoBody" + suffix, count, [&]
+                  {
+                      int hits = 0;
+                      for (int i = 0; i < count; i++)
+                          hits += checkCollisionWithDinoBody(missiles[i], dinos[i]);
+                      keepResult(hits);
+                  });
+        suite.run("checkCollisionWithHelicopter" + suffix, count, [&]
+                  {
+                      int hits = 0;
+                      for (int i = 0; i < count; i++)
+                          hits += checkCollisionWithHelicopter(pilots[i], dinos[i]);
+                      keepResult(hits);
+                  });
+        suite.run("isHelicopterAtDepot" + suffix, count, [&]
+                  {
+                      int inside = 0;
+                      for (int i = 0; i < count; i++)
+                          inside += isHelicopterAtDepot(pilots[i], world.depot);
+                      keepResult(inside);
+                  });
+        // Com as tabelas só guardando os vivos a contagem é constante; fica na
+        // suíte para acusar se voltar a percorrer a população
+        suite.run("countAliveDinos" + suffix, 1, [&] { keepResult(countAliveDinos(world.dinos)); });
 
-            // Verificar colisão com cada dinossauro
-            for (auto &dino : dinos)
-            {
-                if (checkCollisionWithDinoHead(missile, dino))
-                {
-                    missile.active = false;
-                    break;
-                }
-                else if (checkCollisionWithDinoBody(missile, dino))
-                {
-                    missile.active = false;
-                    break;
-                }
-            }
+        // Um passo do laço dos dinossauros: movimento em lote e colisão com a frota
+        world.pendingDinoSteps = 1;
+        suite.run("dinoMovement" + suffix, count, [&] { world.moveDinoChunk(0, 1); });
+        std::vector<Position> &position = world.dinos.column<Position>();
+        std::vector<Velocity> &velocity = world.dinos.column<Velocity>();
+        suite.run("moveAndBounce" + suffix, count,
+                  [&] { moveAndBounce(position.data(), velocity.data(), 0, count, width - 20); });
+        suite.run("moveAndBounceScalar" + suffix, count,
+                  [&] { moveAndBounceScalar(position.data(), velocity.data(), 0, count, width - 20); });
 
-            if (missile.x < width && missile.x >= 0 && missile.active)
-            {
-                drawMissile(missile);
-            }
-            else
-            {
-                missile.active = false;
-            }
+        // Desenho: alterna dois quadros seguidos, então present() sempre
+        // tem diferenças para enviar
+        Renderer renderer;
+        renderer.resize(screenColumns, screenRows);
+        std::array<WorldSnapshot, 2> frames;
+        for (WorldSnapshot &frame : frames)
+        {
+            world.moveDinoChunk(0, 1);
+            world.snapshot(frame);
+        }
+        int next = 0;
+        suite.run("Renderer::compose" + suffix, 1, [&]
+                  {
+                      renderer.compose(frames[next]);
+                      next ^= 1;
+                      keepResult(renderer.back.cells[0]);
+                  });
+        if (screen)
+        {
+            suite.run("drawFrame" + suffix, 1, [&]
+                      {
+                          renderer.compose(frames[next]);
+                          renderer.present();
+                          next ^= 1;
+                      });
         }
+    }
 
-        std::this_thread::sleep_for(std::chrono::milliseconds(20));
+    if (screen)
+    {
+        endwin();
+        delscreen(screen);
     }
+    if (screenOut)
+        fclose(screenOut);
+    if (screenIn)
+        fclose(screenIn);
+
+    if (!suite.writeJson(options.benchPath))
+        return 1;
+    printf("Resultados em %s\n", options.benchPath);
+    return 0;
 }
 
-int countAliveDinos()
+// Valor de uma opção em [1, limit]; 0 se não for número ou estiver fora.
+// Os limites mantêm as reservas do campo e da grade dentro de um int.
+int boundedValue(const char *text, int limit)
 {
-    int count = 0;
-    for (const auto &dino : dinos)
-    {
-        if (dino.alive)
-            count++;
-    }
-    return count;
+    long value = strtol(text, nullptr, 10);
+    return value >= 1 && value <= limit ? (int)value : 0;
 }
 
-void dinoAnimation()
+bool parseOptions(int argc, char **argv, Options &options)
 {
-    while (running && !gameOver)
+    for (int i = 1; i < argc; i++)
     {
+        std::string arg = argv[i];
+        bool hasValue = i + 1 < argc;
+        if (arg == "--headless")
+            options.headless = true;
+        else if (arg == "--ticks" && hasValue)
+            options.ticks = atol(argv[++i]);
+        else if (arg == "--difficulty" && hasValue)
+            options.difficulty = atoi(argv[++i]);
+        else if (arg == "--workers" && hasValue)
+            options.workers = atoi(argv[++i]);
+        else if (arg == "--seed" && hasValue)
         {
-            std::lock_guard<std::mutex> lock(mtx);
-            for (auto &dino : dinos)
-            {
-                if (dino.alive)
-                {
-                    eraseDino(dino);
-
-                    if (dino.movingRight)
-                    {
-                        dino.x++;
-                        if (dino.x > width - 20)
-                        {
-                            dino.movingRight = false;
-                        }
-                    }
-                    else
-                    {
-                        dino.x--;
-                        if (dino.x < 0)
-                        {
-                            dino.movingRight = true;
-                        }
-                    }
-
-                    drawDino(dino);
-
-                    // Verificar colisão com o helicóptero
-                    if (checkCollisionWithHelicopter(dino))
-                    {
-                        gameOver = true;
-                    }
-                }
-            }
-
-            // Verificar Game Over
-            if (countAliveDinos() >= 5)
-            {
-                gameOver = true;
-            }
+            options.seed = strtoull(argv[++i], nullptr, 10);
+            options.seedGiven = true;
+        }
+        else if (arg == "--missile-speed" && hasValue && boundedValue(argv[i + 1], MAX_FIELD_SIDE))
+            options.missileSpeed = boundedValue(argv[++i], MAX_FIELD_SIDE);
+        else if (arg == "--fps" && hasValue && atoi(argv[i + 1]) > 0)
+            options.fps = std::min(atoi(argv[++i]), 1000);
+        else if (arg == "--width" && hasValue && boundedValue(argv[i + 1], MAX_FIELD_SIDE))
+            options.fieldWidth = boundedValue(argv[++i], MAX_FIELD_SIDE);
+        else if (arg == "--height" && hasValue && boundedValue(argv[i + 1], MAX_FIELD_SIDE))
+            options.fieldHeight = boundedValue(argv[++i], MAX_FIELD_SIDE);
+        else if (arg == "--max-dinos" && hasValue && boundedValue(argv[i + 1], MAX_ENTITIES))
+            options.maxDinos = boundedValue(argv[++i], MAX_ENTITIES);
+        else if (arg == "--max-missiles" && hasValue && boundedValue(argv[i + 1], MAX_ENTITIES))
+            options.maxMissiles = boundedValue(argv[++i], MAX_ENTITIES);
+        else if (arg == "--stress")
+            options.headless = options.stress = true;
+        else if (arg == "--trucks" && hasValue && atoi(argv[i + 1]) > 0)
+            options.trucks = std::min(atoi(argv[++i]), MAX_TRUCKS);
+        else if (arg == "--helicopters" && hasValue && atoi(argv[i + 1]) > 0)
+            options.helicopters = std::min(atoi(argv[++i]), MAX_HELICOPTERS);
+        else if (arg == "--depot-bench")
+            options.depotBench = true;
+        else if (arg == "--move-bench")
+            options.moveBench = true;
+        else if (arg == "--bench" && hasValue)
+            options.benchPath = argv[++i];
+        else if (arg == "--bench-filter" && hasValue)
+            options.benchFilter = argv[++i];
+        else if (arg == "--bench-min-time" && hasValue && atof(argv[i + 1]) > 0)
+            options.benchMinTime = atof(argv[++i]);
+        else if (arg == "--check-allocs")
+            options.headless = options.checkAllocs = true;
+        else if (arg == "--config" && hasValue)
+        {
+            if (!loadConfig(argv[++i], options, argv[0]))
+                return false;
+        }
+        else if (arg == "--stats" && hasValue)
+            options.statsPath = argv[++i];
+        else if (arg == "--record" && hasValue)
+            options.recordPath = argv[++i];
+        else if (arg == "--replay" && hasValue)
+            options.replayPath = argv[++i];
+        else if (arg == "--save" && hasValue)
+            options.savePath = argv[++i];
+        else if (arg == "--load" && hasValue)
+            options.loadPath = argv[++i];
+        else
+        {
+            fprintf(stderr,
+                    "Uso: %s [--seed N] [--missile-speed N] [--fps N] [--stats ARQUIVO.json] [--record ARQUIVO]\n"
+                    "       %s --headless [--ticks N] [--difficulty 1|2|3] [--workers N] [--seed N]\n"
+                    "                 [--missile-speed N] [--stress] [--check-allocs]\n"
+                    "       %s --replay ARQUIVO [--workers N]\n"
+                    "       %s --depot-bench [--trucks N] [--helicopters N]\n"
+                    "       %s --move-bench\n"
+                    "       %s --bench ARQUIVO.json [--bench-filter TEXTO] [--bench-min-time SEGUNDOS]\n"
+                    "Campo: [--width N] [--height N] (até 10000) [--max-dinos N] [--max-missiles N] (até 1000000)\n"
+                    "       [--config ARQUIVO]\n"
+                    "Frota: [--trucks N] [--helicopters N] (até 8 cada)\n"
+                    "Jogo salvo: [--save ARQUIVO] (ao sair) [--load ARQUIVO] (continua dele)\n",
+                    argv[0], argv[0], argv[0], argv[0], argv[0], argv[0]);
+            return false;
         }
-
-        std::this_thread::sleep_for(std::chrono::milliseconds(100));
     }
+    if (!options.seedGiven)
+        options.seed = (uint64_t)time(0);
+    return true;
+}
 
-    if (gameOver)
+// Arquivo de configuração: uma opção por linha, com o nome da linha de
+// comando sem os traços ("width 400"); '#' começa um comentário. As opções
+// que vierem depois de --config na linha de comando prevalecem. Um arquivo
+// não inclui outro: "config" dentro dele é recusado, senão um arquivo que
+// aponta para si mesmo recursaria até estourar a pilha.
+bool loadConfig(const char *path, Options &options, char *program)
+{
+    FILE *file = fopen(path, "r");
+    if (!file)
     {
-        std::lock_guard<std::mutex> lock(mtx);
-        mvprintw(height / 2, width / 2 - 5, "GAME OVER");
-        refresh();
+        perror(path);
+        return false;
     }
-}
 
-void spawnDino()
-{
-    while (running && !gameOver)
+    std::vector<std::string> words = {program};
+    char line[256];
+    while (fgets(line, sizeof(line), file))
     {
-        std::this_thread::sleep_for(std::chrono::seconds(t)); // Intervalo baseado na dificuldade
+        if (char *comment = strchr(line, '#'))
+            *comment = '\0';
+        char key[64], value[192];
+        int fields = sscanf(line, "%63s %191s", key, value);
+        if (fields >= 1 && strcmp(key, "config") == 0)
         {
-            std::lock_guard<std::mutex> lock(mtx);
-            if (countAliveDinos() < 5)
-            {
-                int randomHeight = height - 8 - (rand() % 5);
-                Dino newDino = {0, randomHeight, true, true, 0};
-                dinos.push_back(newDino);
-            }
+            fprintf(stderr, "%s: \"config\" não é aceito dentro de um arquivo de configuração\n", path);
+            fclose(file);
+            return false;
         }
+        if (fields >= 1)
+            words.push_back(std::string("--") + key);
+        if (fields == 2)
+            words.push_back(value);
     }
+    fclose(file);
+
+    std::vector<char *> args;
+    for (auto &word : words)
+        args.push_back(&word[0]);
+    return parseOptions((int)args.size(), args.data(), options);
 }
 
-void showDifficultyMenu(int &m, int &n, int &t)
+// Fixa o campo e os limites antes de criar o mundo. Sem tamanho explícito
+// o campo ocupa o terminal; o estresse usa um campo grande e milhares de
+// entidades, a menos que a linha de comando diga outra coisa.
+void applyFieldOptions(const Options &options, int terminalColumns, int terminalRows)
 {
-    clear();
-    mvprintw(0, 0, "Escolha o grau de dificuldade:");
+    width = options.fieldWidth ? options.fieldWidth : options.stress ? 1000 : terminalColumns;
+    height = options.fieldHeight ? options.fieldHeight : options.stress ? 400 : terminalRows;
+    width = std::max(width, MIN_WIDTH);
+    height = std::max(height, MIN_HEIGHT);
+    maxAliveDinos = options.maxDinos ? options.maxDinos : options.stress ? 4001 : 5;
+    maxMissiles = options.maxMissiles ? options.maxMissiles : options.stress ? 4000 : 64;
+    truckCount = options.trucks;
+    helicopterCount = options.helicopters;
+}
 
-    mvprintw(2, 0, "1. Fácil   (m=1, n=20, t=10)");
-    mvprintw(3, 0, "2. Médio   (m=2, n=15, t=7)");
-    mvprintw(4, 0, "3. Difícil (m=3, n=10, t=5)");
-    mvprintw(6, 0, "Escolha (1/2/3): ");
+int main(int argc, char **argv)
+{
+    Options options;
+    if (!parseOptions(argc, argv, options))
+        return 1;
 
-    int choice = 0;
-    while (choice < '1' || choice > '3')
+    if (options.replayPath)
+        return runReplay(options);
+    if (options.depotBench)
+        return runDepotBench(options);
+    if (options.moveBench)
     {
-        choice = getch();
+        applyFieldOptions(options, 100, 40); // --width muda a frequência dos quiques
+        return runMoveBench();
     }
-
-    switch (choice)
+    if (options.benchPath)
+        return runBenchmarks(options);
+    if (options.headless)
     {
-    case '1':
-        m = 1;
-        n = 20;
-        t = 10;
-        break;
-    case '2':
-        m = 2;
-        n = 15;
-        t = 7;
-        break;
-    case '3':
-        m = 3;
-        n = 10;
-        t = 5;
-        break;
+        applyFieldOptions(options, 100, 40);
+        return runHeadless(options);
     }
 
-    clear();
-    mvprintw(0, 0, "Dificuldade selecionada: %s", (choice == '1' ? "Fácil" : (choice == '2' ? "Médio" : "Difícil")));
-    refresh();
-    std::this_thread::sleep_for(std::chrono::seconds(2));
-    clear();
-}
-
-int main()
-{
     initscr();
-    start_color();
+    initColors();
     noecho();
     curs_set(0);
     keypad(stdscr, TRUE);
 
-    init_pair(1, COLOR_BLUE, COLOR_BLUE);   // Céu
-    init_pair(2, COLOR_GREEN, COLOR_GREEN); // Grama
-
-    srand(time(0));
-
-    // Exibir menu de dificuldade
-    showDifficultyMenu(m, n, t);
+    // A ncurses passaria a redimensionar dentro do wgetch() da thread de
+    // entrada; com o sinal tratado aqui isso fica com a thread de desenho
+    signal(SIGWINCH, onTerminalResize);
 
-    // Configurar variáveis globais com base na dificuldade escolhida
-    MAX_HELICOPTER_MISSILES = n;
-    helicopterMissiles.store(MAX_HELICOPTER_MISSILES);
+    ThreadScope mainScope("desenho");
 
-    drawSkyAndGrass(width, height);
+    // Um trabalhador por núcleo além da thread da simulação
+    int cores = (int)std::thread::hardware_concurrency();
+    JobSystem jobs(options.workers >= 0 ? options.workers : std::max(cores - 1, 0));
 
-    depositX = width - 20;
-    depositY = height - 15;
+    // Janela só para leitura: nunca é desenhada, então wgetch() na thread
+    // de entrada não provoca refresh da tela
+    WINDOW *inputWindow = newwin(1, 1, 0, 0);
+    keypad(inputWindow, TRUE);
+    nodelay(inputWindow, TRUE);
+    wnoutrefresh(inputWindow);
 
-    std::thread dinoThread(dinoAnimation);
-    std::thread spawnThread(spawnDino);
-    std::thread truckThread(truckAnimation);
-
-    while (running && !gameOver)
+    // Mundo, filas e threads ficam montados entre as rodadas. No GAME OVER
+    // 'm' volta ao menu, 'q' sai e qualquer outra tecla recomeça na hora.
+    std::unique_ptr<SessionManager> session(new SessionManager(options, jobs, inputWindow));
+    // Nível Difícil até o menu ou o jogo salvo escolherem
+    int m = 3, n = 10, t = 5;
+    const char *resume = options.loadPath; // Só a primeira rodada continua o jogo salvo
+    bool playing = resume || showDifficultyMenu(*session, m, n, t);
+    while (playing)
     {
+        int ch = session->playRound(m, n, t, resume);
+        if (resume)
         {
-            std::lock_guard<std::mutex> lock(mtx);
-            drawHelicopter(helicopterX, helicopterY, helicopterMovingRight);
-            drawDeposit(depositX, depositY);
-            // Exibir informações
-            mvprintw(0, 0, "Mísseis do helicóptero: %d/%d     ", helicopterMissiles.load(), MAX_HELICOPTER_MISSILES);
-            mvprintw(1, 0, "Mísseis do depósito: %d/%d        ", depotMissiles.load(), MAX_DEPOT_MISSILES);
-        }
-
-        int ch = getch();
-
-        {
-            std::lock_guard<std::mutex> lock(mtx);
-            eraseHelicopter(helicopterX, helicopterY);
-        }
-
-        switch (ch)
-        {
-        case KEY_UP:
-            if (helicopterY > 0)
-                helicopterY--;
-            break;
-        case KEY_DOWN:
-            if (helicopterY < height - 2)
-                helicopterY++;
-            break;
-        case KEY_LEFT:
-            if (helicopterX > 0)
-            {
-                helicopterX--;
-                helicopterMovingRight = false;
-            }
-            break;
-        case KEY_RIGHT:
-            if (helicopterX < width - 9)
-            {
-                helicopterX++;
-                helicopterMovingRight = true;
-            }
-            break;
-        case ' ': // Disparar míssil
-        {
-            std::lock_guard<std::mutex> lock(mtx);
-            if (helicopterMissiles.load() > 0)
-            {
-                helicopterMissiles--;
-                Missile missile = {helicopterX + (helicopterMovingRight ? 9 : -1), helicopterY, true, helicopterMovingRight};
-                missileThreads.push_back(std::thread(missileThread, missile));
-            }
-            else
-            {
-                mvprintw(2, 0, "Sem mísseis! Reabasteça no depósito.           ");
-            }
-        }
-        break;
-        case 'q': // Sair do programa
-            running = false;
-            break;
-        }
-
-        // Verificar se o helicóptero está no depósito e gerenciar recarregamento
-        if (isHelicopterAtDepot())
-        {
-            if (helicopterState == HelicopterState::Normal)
-            {
-                // Tentar iniciar o recarregamento
-                std::unique_lock<std::mutex> lock(depotMutex);
-                if ((depotMissiles.load() > 0) && !truckUnloading)
-                {
-                    helicopterReloading = true;
-                    helicopterState = HelicopterState::Reloading;
-                    reloadStartTime = std::chrono::steady_clock::now();
-                    mvprintw(2, 0, "Recarregando...                                       ");
-                }
-                else
-                {
-                    mvprintw(2, 0, "Aguardando para recarregar...                         ");
-                }
-            }
-            else if (helicopterState == HelicopterState::Reloading)
+            resume = nullptr;
+            // Jogo salvo inválido: a dificuldade vem do menu, como sem --load
+            if (ch == ERR)
             {
-                // Verificar se o tempo de recarregamento passou
-                auto now = std::chrono::steady_clock::now();
-                if (now - reloadStartTime >= HELICOPTER_RELOAD_TIME)
-                {
-                    // Finalizar recarregamento
-                    std::unique_lock<std::mutex> lock(depotMutex);
-
-                    int neededMissiles = MAX_HELICOPTER_MISSILES - helicopterMissiles.load();
-                    int missilesToLoad = std::min(neededMissiles, (int)depotMissiles.load());
-                    depotMissiles.fetch_sub(missilesToLoad);
-                    helicopterMissiles.fetch_add(missilesToLoad);
-
-                    // Garantir que não exceda o máximo
-                    if (helicopterMissiles.load() > MAX_HELICOPTER_MISSILES)
-                    {
-                        helicopterMissiles.store(MAX_HELICOPTER_MISSILES);
-                    }
-                    if (depotMissiles.load() < 0)
-                    {
-                        depotMissiles.store(0);
-                    }
-
-                    helicopterReloading = false;
-                    helicopterState = HelicopterState::Normal;
-
-                    // Notificar condições
-                    depotNotFull.notify_all();
-                    depotNotEmpty.notify_all();
-
-                    mvprintw(2, 0, "Recarregamento concluído.                             ");
-                }
-                else
-                {
-                    // Ainda recarregando
-                    mvprintw(2, 0, "Recarregando...                                       ");
-                }
+                playing = showDifficultyMenu(*session, m, n, t);
+                continue;
             }
+            m = session->world.m;
+            n = session->world.n;
+            t = session->world.t;
         }
+        if (ch == 'q')
+            playing = false;
+        else if (ch == 'm')
+            playing = showDifficultyMenu(*session, m, n, t);
         else
-        {
-            // Se o helicóptero sair do depósito durante o recarregamento
-            if (helicopterState == HelicopterState::Reloading)
-            {
-                std::unique_lock<std::mutex> lock(depotMutex);
-                helicopterReloading = false;
-                helicopterState = HelicopterState::Normal;
-                depotNotFull.notify_all();
-                depotNotEmpty.notify_all();
-                mvprintw(2, 0, "Recarregamento cancelado.                             ");
-            }
-        }
+            session->world.message = "Nova rodada.";
     }
+    // Para as threads antes de fechar a janela que a entrada lê
+    session->shutdown();
+    delwin(inputWindow);
 
-    running = false;
-
-    for (auto &t : missileThreads)
-        if (t.joinable())
-            t.join();
+    endwin();
 
-    if (dinoThread.joinable())
-        dinoThread.join();
-    if (spawnThread.joinable())
-        spawnThread.join();
-    if (truckThread.joinable())
-        truckThread.join();
+    World &world = session->world;
+    Renderer &renderer = session->renderer;
+    SnapshotExchange &exchange = session->exchange;
+    unsigned long acquisitions = exchange.mutex.total(&LockCounters::acquisitions);
+    unsigned long contended = exchange.mutex.total(&LockCounters::contended);
+    printf("Trava da troca de quadros: %lu aquisições, %lu com espera (%.2f%%)\n",
+           acquisitions, contended, acquisitions ? 100.0 * contended / acquisitions : 0.0);
+    LatencySummary tick = world.tickTimes.summary();
+    LatencySummary frame = renderer.frameTimes.summary();
+    printf("Tick:   p50 %.1f us, p99 %.1f us, máx %.1f us\n", tick.p50, tick.p99, tick.max);
+    printf("Quadro: p50 %.1f us, p99 %.1f us, máx %.1f us\n", frame.p50, frame.p99, frame.max);
+    const FramePacer &pacer = renderer.pacer;
+    printf("Quadros: %ld enviados, %.1f q/s de média (alvo %d), %ld prazos perdidos, %ld ticks juntados\n",
+           pacer.presented, pacer.averageFps(), pacer.targetFps, pacer.dropped, pacer.coalesced);
+    printf("Rodadas: %d, encerramento da última: %.0f us\n", session->rounds, session->shutdownMicros);
+    if (session->saved)
+        printf("Jogo salvo em %s\n", options.savePath);
 
-    endwin();
+    if (options.statsPath)
+        writeStats(options.statsPath, world, renderer, exchange.mutex);
     return 0;
 }